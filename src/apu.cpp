@@ -1,20 +1,17 @@
 #include "apu.h"
 
+#include <algorithm>
+
 #include "log.h"
+#include "dmg.h"
 
 
-APU::APU() : mmu(nullptr)
+APU::APU() : dmg(nullptr), mmu(nullptr), audio(nullptr), synthesis_enabled(true)
 {
 
 }
 
 
-APU::~APU()
-{
-    SDL_CloseAudioDevice(audio_device);
-}
-
-
 bool APU::init()
 {
     if (mmu == nullptr) {
@@ -27,21 +24,6 @@ bool APU::init()
     play_wave = true;
     play_noise = true;
 
-    SDL_AudioSpec audio_spec;
-    SDL_zero(audio_spec);
-    audio_spec.freq = SOUND_FREQUENCY;
-    audio_spec.format = AUDIO_S16SYS;
-    audio_spec.channels = 2;
-    audio_spec.samples = SOUND_DOWNSAMPLE_SAMPLES;
-
-     audio_device = SDL_OpenAudioDevice(NULL, 0, &audio_spec, NULL, 0);
-     if (audio_device <= 0) {
-        error("Erreur d'ouverture audio: %s\n", SDL_GetError());
-        return false;
-    }
-
-    SDL_PauseAudioDevice(audio_device, 0);
-
     pulse_a.set_mmu(mmu);
     pulse_b.set_mmu(mmu);
     wave.set_mmu(mmu);
@@ -57,6 +39,10 @@ bool APU::init()
     wave.init();
     noise.init();
 
+    for (BlipBuffer &buffer : generator_buffers) {
+        buffer.set_rates(SOUND_CLOCK_RATE, SOUND_FREQUENCY);
+    }
+
     return true;
 }
 
@@ -64,9 +50,13 @@ bool APU::init()
 void APU::reset()
 {
     clock = 0;
-    downsample_clock = 0;
+    synthesis_clock = 0;
     buffer_count = 0;
 
+    for (BlipBuffer &buffer : generator_buffers) {
+        buffer.clear();
+    }
+
     // Sound control
     activated = false;
     vin_so1 = false;
@@ -90,15 +80,11 @@ void APU::reset()
 
 
 /**
- * @brief      Called each SOUND_CLOCK_STEP clock ticks
+ * @brief      Called when the frame sequencer steps or the sample buffer is due
  */
 void APU::step()
 {
-    update();
-
-    if (clock >= downsample_clock) {
-        downsample();
-    }
+    synthesize(clock);
 
     if (clock >= pulse_a.sequencer_clock) {
         pulse_a.frame_sequencer();
@@ -113,16 +99,13 @@ void APU::step()
         noise.frame_sequencer();
     }
 
-    clock = pulse_a.duty_clock;
-    if (pulse_b.duty_clock < clock) {
-        clock = pulse_b.duty_clock;
-    }
-    if (wave.wave_clock < clock) {
-        clock = wave.wave_clock;
-    }
-    if (downsample_clock < clock) {
-        clock = downsample_clock;
+    // Sample filling the buffer, only the frame sequencer in audio-null mode
+    clock = SIZE_MAX;
+    if (synthesis_enabled) {
+        size_t frames_left = (SOUND_DOWNSAMPLE_BUFFER_SIZE - buffer_count) / SOUND_CHANNEL_COUNT;
+        clock = synthesis_clock + generator_buffers[0].clocks_needed(frames_left);
     }
+
     if (pulse_a.sequencer_clock < clock) {
         clock = pulse_a.sequencer_clock;
     }
@@ -138,122 +121,150 @@ void APU::step()
 }
 
 
-void APU::update()
+/**
+ * @brief      Brings the sound up to the current clock before a register changes
+ */
+void APU::catch_up()
 {
-    if (clock >= pulse_a.duty_clock) {
-        pulse_a.update();
+    // Not running inside a DMG, there is no clock to follow
+    if (dmg == nullptr) {
+        return;
     }
-    if (clock >= pulse_b.duty_clock) {
-        pulse_b.update();
+
+    synthesize(dmg->get_current_clock());
+}
+
+
+/**
+ * @brief      Generates the samples due until the given clock
+ *
+ * Channels are only stepped here: each one records its output changes in a
+ * row, then the whole samples resampled from them are mixed together.
+ * @param[in]  target  Clock to catch up with
+ */
+void APU::synthesize(size_t target)
+{
+    // Audio-null mode: channels are left as they are
+    if (!synthesis_enabled) {
+        if (target > synthesis_clock) {
+            synthesis_clock = target;
+        }
+        return;
     }
-    if (clock >= wave.wave_clock) {
-        wave.update();
+
+    pulse_a.render(generator_buffers[0], synthesis_clock, target);
+    pulse_b.render(generator_buffers[1], synthesis_clock, target);
+    wave.render(generator_buffers[2], synthesis_clock, target);
+    noise.render(generator_buffers[3], synthesis_clock, target);
+
+    if (target <= synthesis_clock) {
+        return;
     }
-    if (clock >= noise.lfsr_clock) {
-        noise.update();
+
+    for (BlipBuffer &buffer : generator_buffers) {
+        buffer.end_frame(target - synthesis_clock);
     }
-}
+    synthesis_clock = target;
 
+    size_t avail = generator_buffers[0].samples_avail();
+    while (avail > 0) {
+        size_t count = (SOUND_DOWNSAMPLE_BUFFER_SIZE - buffer_count) / SOUND_CHANNEL_COUNT;
+        if (count > avail) {
+            count = avail;
+        }
 
-void APU::mixer()
-{
-    int16_t *result_left = sample + buffer_count++;
-    int16_t *result_right = sample + buffer_count++;
+        for (size_t i=0; i<SOUND_GENERATOR_COUNT; i++) {
+            generator_buffers[i].read_samples(generator_samples[i], count);
+        }
 
-    *result_left = 0;
-    *result_right = 0;
+        mixer(count);
+        avail -= count;
 
-    int16_t data[] = {
-        0, 0, 0, 0
-    };
+        // Buffer full, send to audio
+        if (buffer_count >= SOUND_DOWNSAMPLE_BUFFER_SIZE) {
+            if (audio != nullptr) {
+                audio->queue(sample, SOUND_DOWNSAMPLE_BUFFER_SIZE);
+            }
 
-    if (activated) {
-        if (play_pulse_a) { data[0] = pulse_a.get_output(); }
-        if (play_pulse_b) { data[1] = pulse_b.get_output(); }
-        if (play_wave) { data[2] = wave.get_output(); }
-        if (play_noise) { data[3] = noise.get_output(); }
+            buffer_count = 0;
+        }
     }
+}
 
-    bool to_so1[] = {
-        pulse_a_so1,
-        pulse_b_so1,
-        wave_so1,
-        noise_so1
+
+/**
+ * @brief      Mixes the generators output into the buffer
+ *
+ * Routing and levels are turned into one integer gain per generator and
+ * terminal, the loop over samples then only multiplies, adds and clamps
+ * so it is vectorized.
+ * @param[in]  count  How many samples were rendered
+ */
+void APU::mixer(size_t count)
+{
+    bool play[] = {
+        activated && play_pulse_a,
+        activated && play_pulse_b,
+        activated && play_wave,
+        activated && play_noise
     };
 
-    bool to_so2[] = {
+    // SO2 is the left terminal, SO1 the right one
+    bool to_left[] = {
         pulse_a_so2,
         pulse_b_so2,
         wave_so2,
         noise_so2
     };
 
-    // Left
-    for (size_t i=0; i<4; i++) {
-        if (to_so1[i]) {
-            SDL_MixAudioFormat(
-                (Uint8*)result_left,
-                (Uint8*)&data[i],
-                AUDIO_S16SYS,
-                sizeof(int16_t),
-                so1_level * (128 / 7.0)
-            );
-        }
-    }
+    bool to_right[] = {
+        pulse_a_so1,
+        pulse_b_so1,
+        wave_so1,
+        noise_so1
+    };
 
-    // Right
-    for (size_t i=0; i<4; i++) {
-        if (to_so2[i]) {
-            SDL_MixAudioFormat(
-                (Uint8*)result_right,
-                (Uint8*)&data[i],
-                AUDIO_S16SYS,
-                sizeof(int16_t),
-                so2_level * (128 / 7.0)
-            );
-        }
+    // Levels go from 1/8 to 8/8
+    int32_t left_gains[SOUND_GENERATOR_COUNT];
+    int32_t right_gains[SOUND_GENERATOR_COUNT];
+    for (size_t i=0; i<SOUND_GENERATOR_COUNT; i++) {
+        left_gains[i] = play[i] && to_left[i] ? so2_level + 1 : 0;
+        right_gains[i] = play[i] && to_right[i] ? so1_level + 1 : 0;
     }
 
-    // Amplify
-    *result_left *= 1000;
-    *result_right *= 1000;
-}
+    int16_t *output = sample + buffer_count;
 
+    for (size_t n=0; n<count; n++) {
+        int32_t left = 0;
+        int32_t right = 0;
 
-/**
- * @brief      Adds a sound sample in the buffer (nearest neighboor on the audio sampler)
- */
-void APU::downsample()
-{
-    downsample_clock += SOUND_DOWNSAMPLE_CLOCK_STEP;
-
-    mixer();
-
-    // Buffer full, send to audio
-    if (buffer_count >= SOUND_DOWNSAMPLE_BUFFER_SIZE) {
-        // Let buffer be drained
-        while (SDL_GetQueuedAudioSize(audio_device) > SOUND_DOWNSAMPLE_BUFFER_SIZE * sizeof(int16_t)) {
-            SDL_Delay(1);
+        for (size_t i=0; i<SOUND_GENERATOR_COUNT; i++) {
+            left += generator_samples[i][n] * left_gains[i];
+            right += generator_samples[i][n] * right_gains[i];
         }
 
-        SDL_QueueAudio(audio_device, sample, SOUND_DOWNSAMPLE_BUFFER_SIZE * sizeof(int16_t));
+        left >>= SOUND_LEVEL_BITS;
+        right >>= SOUND_LEVEL_BITS;
 
-        buffer_count = 0;
+        output[n * 2] = std::clamp(left, int32_t(INT16_MIN), int32_t(INT16_MAX));
+        output[n * 2 + 1] = std::clamp(right, int32_t(INT16_MIN), int32_t(INT16_MAX));
     }
+
+    buffer_count += count * SOUND_CHANNEL_COUNT;
 }
 
 
 /**
  * @brief      Set level and Vin output
- * @param[in]  value  The value of those things
+ * @param[in]  value  SO2 in the upper nibble, SO1 in the lower one
  */
 void APU::set_NR50(uint8_t value)
 {
-    vin_so1 = value & 0b10000000;
-    vin_so2 = value & 0b00001000;
+    vin_so2 = value & 0b10000000;
+    vin_so1 = value & 0b00001000;
 
-    so1_level = (value & 0b01110000) >> 4;
-    so2_level = value & 0b00000111;
+    so2_level = (value & 0b01110000) >> 4;
+    so1_level = value & 0b00000111;
 }
 
 
@@ -265,8 +276,8 @@ void APU::set_NR51(uint8_t value)
 {
     noise_so2 = value & 0b10000000;
     wave_so2 = value & 0b01000000;
-    pulse_b_so2 = value & 0b001000000;
-    pulse_a_so2 = value & 0b000100000;
+    pulse_b_so2 = value & 0b00100000;
+    pulse_a_so2 = value & 0b00010000;
     noise_so1 = value & 0b00001000;
     wave_so1 = value & 0b00000100;
     pulse_b_so1 = value & 0b00000010;
@@ -308,7 +319,7 @@ bool APU::is_power_on()
 void APU::adjust_clocks(size_t adjustment)
 {
     clock -= adjustment;
-    downsample_clock -= adjustment;
+    synthesis_clock -= adjustment;
 
     pulse_a.adjust_clocks(adjustment);
     pulse_b.adjust_clocks(adjustment);
@@ -325,7 +336,7 @@ void APU::set_mmu(MMU *mmu)
 
 void APU::serialize(std::ofstream &file)
 {
-    file.write(reinterpret_cast<char*>(&downsample_clock), sizeof(size_t));
+    file.write(reinterpret_cast<char*>(&synthesis_clock), sizeof(size_t));
     file.write(reinterpret_cast<char*>(&buffer_count), sizeof(size_t));
 
     file.write(reinterpret_cast<char*>(sample), sizeof(int16_t) * SOUND_DOWNSAMPLE_BUFFER_SIZE);
@@ -361,7 +372,7 @@ void APU::serialize(std::ofstream &file)
 
 void APU::deserialize(std::ifstream &file)
 {
-    file.read(reinterpret_cast<char*>(&downsample_clock), sizeof(size_t));
+    file.read(reinterpret_cast<char*>(&synthesis_clock), sizeof(size_t));
     file.read(reinterpret_cast<char*>(&buffer_count), sizeof(size_t));
 
     file.read(reinterpret_cast<char*>(sample), sizeof(int16_t) * SOUND_DOWNSAMPLE_BUFFER_SIZE);
@@ -392,6 +403,11 @@ void APU::deserialize(std::ifstream &file)
     pulse_b.deserialize(file);
     wave.deserialize(file);
     noise.deserialize(file);
+
+    // Deltas are not saved, synthesis restarts from silence
+    for (BlipBuffer &buffer : generator_buffers) {
+        buffer.clear();
+    }
 }
 
 
@@ -399,3 +415,32 @@ void APU::set_dmg(DMG *dmg)
 {
     this->dmg = dmg;
 }
+
+
+void APU::set_audio_sink(AudioSink *audio)
+{
+    this->audio = audio;
+}
+
+
+/**
+ * @brief      Audio-null mode when disabled: waveforms are not generated,
+ *             mixed nor output. Registers and the frame sequencer still run.
+ * @param[in]  enabled  Whether samples are produced
+ */
+void APU::set_synthesis(bool enabled)
+{
+    if (enabled && !synthesis_enabled) {
+        // Channels were left behind, restart from silence
+        pulse_a.resume(synthesis_clock);
+        pulse_b.resume(synthesis_clock);
+        wave.resume(synthesis_clock);
+        noise.resume(synthesis_clock);
+
+        for (BlipBuffer &buffer : generator_buffers) {
+            buffer.clear();
+        }
+    }
+
+    synthesis_enabled = enabled;
+}
@@ -1,10 +1,10 @@
 #ifndef APU_H
 #define APU_H
 
-#include <SDL2/SDL.h>
-
 #include "defines.h"
 #include "mmu.h"
+#include "sink.h"
+#include "blip_buffer.h"
 #include "channels/pulse_a.h"
 #include "channels/pulse_b.h"
 #include "channels/wave.h"
@@ -20,20 +20,25 @@ class DMG;
 class APU {
     DMG *dmg;
     MMU *mmu;
+    AudioSink *audio;
 
     PulseA pulse_a;
     PulseB pulse_b;
     Wave wave;
     Noise noise;
 
-    SDL_AudioSpec audio_spec;
-    SDL_AudioDeviceID audio_device;
+    // Band-limited synthesis
+    bool synthesis_enabled;         // Audio-null mode when false
+    size_t synthesis_clock;         // Generators output is known until there
+    BlipBuffer generator_buffers[SOUND_GENERATOR_COUNT];
 
     // Downsampler
-    size_t downsample_clock;        // Determines when to take a sample
     size_t buffer_count;            // Size of occupied buffer (2 incrmeent = one sample)
     int16_t sample[SOUND_DOWNSAMPLE_BUFFER_SIZE]; // 2 * int16_t per sample
 
+    // Output of each generator for the samples being mixed
+    int16_t generator_samples[SOUND_GENERATOR_COUNT][SOUND_DOWNSAMPLE_SAMPLES];
+
     // Sound control
     bool vin_so1;
     bool vin_so2;
@@ -61,16 +66,14 @@ public:
     bool activated;
 
     APU();
-    ~APU();
 
     bool init();
     void reset();
     void step();
-    void update();
+    void catch_up();
+    void synthesize(size_t target);
 
-    void mixer();
-    void downsample();
-    void frame_sequencer();
+    void mixer(size_t count);
 
     void set_NR10(uint8_t value) { pulse_a.set_NR10(value); };
     void set_NR11(uint8_t value) { pulse_a.set_NR11(value); };
@@ -101,6 +104,8 @@ public:
 
     void set_mmu(MMU *mmu);
     void set_dmg(DMG *dmg);
+    void set_audio_sink(AudioSink *audio);
+    void set_synthesis(bool enabled);
 
     void serialize(std::ofstream &file);
     void deserialize(std::ifstream &file);
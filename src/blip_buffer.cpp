@@ -0,0 +1,187 @@
+#include "blip_buffer.h"
+
+#include <math.h>
+#include <string.h>
+
+
+/**
+ * @brief      Band-limited impulse for each sub-sample position
+ *
+ * Taps of a phase are contiguous so adding a delta is a single loop the
+ * compiler can vectorize.
+ */
+struct BlipKernel {
+    alignas(64) int32_t taps[BLIP_PHASE_COUNT][BLIP_KERNEL_WIDTH];
+
+    /**
+     * @brief      Blackman windowed sinc, each phase summing to exactly 1
+     */
+    BlipKernel()
+    {
+        const double half_width = BLIP_KERNEL_WIDTH / 2;
+
+        for (size_t phase=0; phase<BLIP_PHASE_COUNT; phase++) {
+            double values[BLIP_KERNEL_WIDTH];
+            double total = 0;
+
+            for (size_t tap=0; tap<BLIP_KERNEL_WIDTH; tap++) {
+                // Impulse centered between taps half_width - 1 and half_width
+                double x = tap - (half_width - 1) - phase / double(BLIP_PHASE_COUNT);
+
+                double sinc = 2 * BLIP_CUTOFF;
+                if (x != 0) {
+                    sinc = sin(2 * M_PI * BLIP_CUTOFF * x) / (M_PI * x);
+                }
+
+                double window = 0.42 + 0.5 * cos(M_PI * x / half_width) +
+                    0.08 * cos(2 * M_PI * x / half_width);
+
+                values[tap] = sinc * window;
+                total += values[tap];
+            }
+
+            // Rounding error goes to the biggest tap so a step settles exactly
+            int32_t sum = 0;
+            size_t biggest = 0;
+            for (size_t tap=0; tap<BLIP_KERNEL_WIDTH; tap++) {
+                taps[phase][tap] = lround(values[tap] / total * (1 << BLIP_KERNEL_BITS));
+                sum += taps[phase][tap];
+
+                if (values[tap] > values[biggest]) {
+                    biggest = tap;
+                }
+            }
+            taps[phase][biggest] += (1 << BLIP_KERNEL_BITS) - sum;
+        }
+    }
+};
+
+static const BlipKernel kernel;
+
+
+BlipBuffer::BlipBuffer() :
+    factor(0)
+{
+    clear();
+}
+
+
+/**
+ * @brief      Drops all samples and deltas
+ */
+void BlipBuffer::clear()
+{
+    memset(buffer, 0, sizeof(buffer));
+
+    offset = 0;
+    integrator = 0;
+}
+
+
+/**
+ * @param[in]  clock_rate   Clocks per second of the input
+ * @param[in]  sample_rate  Samples per second of the output
+ */
+void BlipBuffer::set_rates(size_t clock_rate, size_t sample_rate)
+{
+    factor = (uint64_t(sample_rate) << BLIP_FRAC_BITS) / clock_rate;
+}
+
+
+/**
+ * @brief      Changes the amplitude of the signal
+ * @param[in]  time   Clock in the current frame
+ * @param[in]  delta  Amplitude difference, on 16 bits
+ */
+void BlipBuffer::add_delta(size_t time, int32_t delta)
+{
+    uint64_t position = offset + time * factor;
+    size_t index = position >> BLIP_FRAC_BITS;
+    size_t phase = (position >> (BLIP_FRAC_BITS - BLIP_PHASE_BITS)) & (BLIP_PHASE_COUNT - 1);
+
+    // Beyond what was ever meant to be buffered
+    if (index > BLIP_BUFFER_SIZE) {
+        return;
+    }
+
+    const int32_t *taps = kernel.taps[phase];
+    int32_t *out = buffer + index;
+    for (size_t tap=0; tap<BLIP_KERNEL_WIDTH; tap++) {
+        out[tap] += taps[tap] * delta;
+    }
+}
+
+
+/**
+ * @brief      Makes the samples of the frame available, next frame starts after
+ * @param[in]  duration  Clocks in the frame
+ */
+void BlipBuffer::end_frame(size_t duration)
+{
+    offset += duration * factor;
+}
+
+
+/**
+ * @brief      How many samples can be read
+ */
+size_t BlipBuffer::samples_avail()
+{
+    size_t avail = offset >> BLIP_FRAC_BITS;
+    if (avail > BLIP_BUFFER_SIZE) {
+        avail = BLIP_BUFFER_SIZE;
+    }
+
+    return avail;
+}
+
+
+/**
+ * @brief      How long the frame has to be for some samples to be available
+ * @param[in]  samples  The number of samples
+ * @return     Clocks since the frame start
+ */
+size_t BlipBuffer::clocks_needed(size_t samples)
+{
+    uint64_t position = uint64_t(samples) << BLIP_FRAC_BITS;
+    if (position <= offset) {
+        return 0;
+    }
+
+    return (position - offset + factor - 1) / factor;
+}
+
+
+/**
+ * @brief      Integrates samples then removes them from the buffer
+ * @param      samples  Where to store them
+ * @param[in]  count    How many, at most samples_avail()
+ */
+void BlipBuffer::read_samples(int16_t *samples, size_t count)
+{
+    int32_t sum = integrator;
+
+    for (size_t i=0; i<count; i++) {
+        sum += buffer[i];
+
+        int32_t sample = sum >> BLIP_KERNEL_BITS;
+        if (sample > INT16_MAX) {
+            sample = INT16_MAX;
+        } else if (sample < INT16_MIN) {
+            sample = INT16_MIN;
+        }
+        samples[i] = sample;
+
+        // Leaks slowly toward zero: high-pass filter
+        sum -= sample * (1 << (BLIP_KERNEL_BITS - BLIP_BASS_SHIFT));
+    }
+
+    integrator = sum;
+
+    // Keeps the deltas of the samples not read
+    size_t remaining = samples_avail() - count + BLIP_KERNEL_WIDTH;
+    memmove(buffer, buffer + count, sizeof(int32_t) * remaining);
+    memset(buffer + remaining, 0, sizeof(int32_t) * count);
+
+    offset -= uint64_t(count) << BLIP_FRAC_BITS;
+}
@@ -0,0 +1,41 @@
+#ifndef BLIP_BUFFER_H
+#define BLIP_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defines.h"
+
+
+/**
+ * @brief      Band-limited synthesis of a signal given by its changes
+ *
+ * Amplitude deltas are added at exact clocks, each one as a band-limited
+ * step taken from a precomputed kernel, then the buffer is integrated into
+ * samples at the output rate. Nothing is done between two changes.
+ *
+ * Clocks are relative to the start of the current frame, end_frame() makes
+ * the samples of the frame available and starts the next one.
+ */
+class BlipBuffer {
+    int32_t buffer[BLIP_BUFFER_SIZE + BLIP_KERNEL_WIDTH];  // Deltas spread by the kernel
+
+    uint64_t factor;        // Samples per clock, BLIP_FRAC_BITS fixed point
+    uint64_t offset;        // Position of the frame start, BLIP_FRAC_BITS fixed point
+    int32_t integrator;     // Sum of the deltas read so far
+
+public:
+    BlipBuffer();
+
+    void clear();
+    void set_rates(size_t clock_rate, size_t sample_rate);
+
+    void add_delta(size_t time, int32_t delta);
+    void end_frame(size_t duration);
+
+    size_t samples_avail();
+    size_t clocks_needed(size_t samples);
+    void read_samples(int16_t *samples, size_t count);
+};
+
+#endif /* BLIP_BUFFER_H */
@@ -5,9 +5,11 @@
 
 #include "mbc/none.h"
 #include "mbc/mbc1.h"
+#include "mbc/mbc3.h"
+#include "mbc/mbc5.h"
 
 
-Cartridge::Cartridge()
+Cartridge::Cartridge() : dmg(nullptr), rom(nullptr)
 {
     // Default empty random cartridge
     cartridge_type = CART_TYPE_ROM_ONLY;
@@ -30,6 +32,8 @@ Cartridge::~Cartridge()
     }
 
     clear_mbc();
+
+    RomImage::release(rom);
 }
 
 
@@ -51,70 +55,93 @@ bool Cartridge::load(std::string rom_path)
     info("Loading cartridge ROM: %s\n", rom_path.c_str());
     this->rom_path = rom_path;
 
-    FILE *f = fopen(rom_path.c_str(), "rb");
-    if (f == NULL) {
+    RomImage *image = RomImage::acquire(rom_path);
+    if (image == nullptr) {
         error("Unable to read provided cartridge ROM file\n");
         return false;
     }
 
-    uint8_t memory_bank[MBC_SIZE];
-    size_t address = 0;     //!< Address in the memory bank being read
-    size_t mb_index = 0;    //!< Index of memory bank
-    while (fread(&memory_bank[address++], sizeof(uint8_t), 1, f) == 1) {
-        if (address != MBC_SIZE) {
-            continue;
-        }
-
-        // First memory bank: We need the type of MBC to use
-        if (mb_index == 0) {
-            cartridge_type = memory_bank[CARTRIDGE_TYPE_ADDRESS];
-            rom_type = memory_bank[ROM_SIZE_ADDRESS];
-            ram_type = memory_bank[RAM_SIZE_ADDRESS];
-
-            size_t rom_bank_count = Cartridge::get_rom_bank_count(rom_type);
-
-            clear_mbc();
-
-            switch(cartridge_type) {
-            case CART_TYPE_ROM_ONLY:
-                mbc = new NoMBC();
-                break;
-            case CART_TYPE_MBC1_RAM_BATTERY:
-                has_battery = true;
-                __attribute__ ((fallthrough));
-            case CART_TYPE_MBC1:
-            case CART_TYPE_MBC1_RAM:
-                mbc = new MBC1(rom_bank_count, ram_type);
-                break;
-            default:
-                error("Please implement cartridge type 0x%02X\n", cartridge_type);
-                return false;
-            }
-
-            if (mbc == nullptr) {
-                error("Unable to allocate space for the MBC\n");
-                return false;
-            }
-
-            mbc->init();
-
-            if (has_battery) {
-                load_ram();
-            }
-        }
-
-        if (!mbc->load(mb_index, memory_bank)) {
-            return false;
-        }
-
-        mb_index += 1;
-        address = 0;
+    // Only whole banks are used
+    size_t bank_count = image->get_size() / MBC_SIZE;
+    if (bank_count == 0) {
+        error("Cartridge ROM is too small\n");
+        RomImage::release(image);
+        return false;
     }
 
-    // Failure of reading not EOF related
-    if (!feof(f)) {
-        error("Unkown error prevented the loading of the game cartridge ROM\n");
-        debug("MB index: %zu, address %zu\n", mb_index, address);
+    clear_mbc();
+
+    RomImage::release(rom);
+    rom = image;
+
+    // First memory bank: We need the type of MBC to use
+    const uint8_t *memory_bank = rom->get_data();
+    cartridge_type = memory_bank[CARTRIDGE_TYPE_ADDRESS];
+    rom_type = memory_bank[ROM_SIZE_ADDRESS];
+    ram_type = memory_bank[RAM_SIZE_ADDRESS];
+
+    if (!create_mbc()) {
+        return false;
+    }
+
+    mbc->init();
+
+    if (has_battery) {
+        load_ram();
+    }
+
+    return mbc->load(rom->get_data(), bank_count);
+}
+
+
+/**
+ * @brief      Instantiates the MBC given by the cartridge type
+ * @return     true if the type is supported
+ */
+bool Cartridge::create_mbc()
+{
+    size_t rom_bank_count = Cartridge::get_rom_bank_count(rom_type);
+
+    switch(cartridge_type) {
+    case CART_TYPE_ROM_ONLY:
+        mbc = new NoMBC();
+        break;
+    case CART_TYPE_MBC1_RAM_BATTERY:
+        has_battery = true;
+        __attribute__ ((fallthrough));
+    case CART_TYPE_MBC1:
+    case CART_TYPE_MBC1_RAM:
+        mbc = new MBC1(rom_bank_count, ram_type);
+        break;
+    case CART_TYPE_MBC3_TIMER_BATTERY:
+    case CART_TYPE_MBC3_TIMER_RAM_BATTERY:
+        has_battery = true;
+        mbc = new MBC3(rom_bank_count, ram_type, true, dmg);
+        break;
+    case CART_TYPE_MBC3_RAM_BATTERY:
+        has_battery = true;
+        __attribute__ ((fallthrough));
+    case CART_TYPE_MBC3:
+    case CART_TYPE_MBC3_RAM:
+        mbc = new MBC3(rom_bank_count, ram_type, false, dmg);
+        break;
+    case CART_TYPE_MBC5_RAM_BATTERY:
+    case CART_TYPE_MBC5_RUMBLE_RAM_BATTERY:
+        has_battery = true;
+        __attribute__ ((fallthrough));
+    case CART_TYPE_MBC5:
+    case CART_TYPE_MBC5_RAM:
+    case CART_TYPE_MBC5_RUMBLE:
+    case CART_TYPE_MBC5_RUMBLE_RAM:
+        mbc = new MBC5(rom_bank_count, ram_type);
+        break;
+    default:
+        error("Please implement cartridge type 0x%02X\n", cartridge_type);
+        return false;
+    }
+
+    if (mbc == nullptr) {
+        error("Unable to allocate space for the MBC\n");
         return false;
     }
 
@@ -133,6 +160,12 @@ uint8_t Cartridge::get(uint16_t address)
 }
 
 
+/**
+ * @brief      Writes to the MBC registers or RAM
+ * @param[in]  address  The address
+ * @param[in]  value    The value
+ * @return     true if the banks mapped changed
+ */
 bool Cartridge::set(uint16_t address, uint8_t value)
 {
     return mbc->set(address, value);
@@ -145,6 +178,16 @@ bool Cartridge::has_ram()
 }
 
 
+/**
+ * @brief      Cartridge clocks follow the emulated time of the given DMG
+ * @param      dmg   The DMG, nullptr for clocks that never move
+ */
+void Cartridge::set_dmg(DMG *dmg)
+{
+    this->dmg = dmg;
+}
+
+
 std::string Cartridge::get_save_name()
 {
     return rom_path + ".sav";
@@ -162,6 +205,7 @@ void Cartridge::save_ram()
     file.open(get_save_name(), std::ios::binary);
 
     file.write(reinterpret_cast<const char*>(mbc->ram), sizeof(uint8_t) * mbc->ram_size);
+    mbc->save_clock(file);
 
     file.close();
 }
@@ -181,6 +225,7 @@ void Cartridge::load_ram()
     }
 
     file.read(reinterpret_cast<char*>(mbc->ram), sizeof(uint8_t) * mbc->ram_size );
+    mbc->load_clock(file);
 
     file.close();
 }
@@ -203,6 +248,7 @@ size_t Cartridge::get_rom_bank_count(uint8_t rom_type)
     case 0x05: return 64;
     case 0x06: return 128;
     case 0x07: return 256;
+    case 0x08: return 512;
     case 0x52: return 72;
     case 0x53: return 80;
     case 0x54: return 96;
@@ -220,6 +266,8 @@ size_t Cartridge::get_ram_bank_count(uint8_t ram_type)
     switch(ram_type) {
     default: return 1;
     case 03: return 4;
+    case 04: return 16;
+    case 05: return 8;
     case 06: return 16;
     }
 }
@@ -238,6 +286,8 @@ size_t Cartridge::get_ram_size(uint8_t ram_type)
     case 01: return 1;
     case 02: return 8;
     case 03: return 32;
+    case 04: return 128;
+    case 05: return 64;
     case 06: return 128;
     }
 }
@@ -263,18 +313,13 @@ void Cartridge::deserialize(std::ifstream &file)
     file.read(reinterpret_cast<char*>(&ram_type), sizeof(uint8_t));
     file.read(reinterpret_cast<char*>(&has_battery), sizeof(bool));
 
-    size_t rom_bank_count = Cartridge::get_rom_bank_count(rom_type);
+    if (!create_mbc()) {
+        return;
+    }
 
-    switch(cartridge_type) {
-    case CART_TYPE_ROM_ONLY:
-        mbc = new NoMBC();
-        break;
-    case CART_TYPE_MBC1:
-    case CART_TYPE_MBC1_RAM:
-    case CART_TYPE_MBC1_RAM_BATTERY:
-    default:
-        mbc = new MBC1(rom_bank_count, ram_type);
-        break;
+    // ROM is not part of the state, it is still the one loaded
+    if (rom != nullptr) {
+        mbc->load(rom->get_data(), rom->get_size() / MBC_SIZE);
     }
 
     mbc->deserialize(file);
@@ -6,12 +6,21 @@
 #include <fstream>
 
 #include "mbc.h"
+#include "rom_image.h"
+
+
+class DMG;
 
 
 /**
  * @brief      DMG Emulator
  */
 class Cartridge {
+    DMG *dmg;
+    RomImage *rom;
+
+    bool create_mbc();
+
 public:
     MBC *mbc;
     uint8_t cartridge_type;
@@ -32,6 +41,8 @@ public:
 
     bool has_ram();
 
+    void set_dmg(DMG *dmg);
+
     std::string get_save_name();
     void save_ram();
     void load_ram();
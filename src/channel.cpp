@@ -46,6 +46,10 @@ void Channel::reset()
 
     // DAC
     dac_enabled = false;
+    dac_output = 0;
+
+    // Synthesis
+    amplitude = 0;
 }
 
 
@@ -60,6 +64,54 @@ void Channel::update()
 }
 
 
+/**
+ * @brief      Generates the output until the given clock included
+ * @param      buffer  Where to record the output changes
+ * @param[in]  start   Clock of the buffer frame start
+ * @param[in]  target  The clock
+ */
+void Channel::render(BlipBuffer &buffer, size_t start, size_t target)
+{
+    // Changed by a register or the frame sequencer since last time
+    record(buffer, 0);
+
+    while (get_clock() <= target) {
+        size_t time = get_clock() > start ? get_clock() - start : 0;
+
+        update();
+        record(buffer, time);
+    }
+}
+
+
+/**
+ * @brief      Restarts the output from silence after it was not generated
+ * @param[in]  clock  Where the output restarts, ticks before are dropped
+ */
+void Channel::resume(size_t clock)
+{
+    if (get_clock() < clock) {
+        set_clock(clock);
+    }
+
+    amplitude = 0;
+}
+
+
+/**
+ * @brief      Gives the output to the buffer when it changed
+ */
+void Channel::record(BlipBuffer &buffer, size_t time)
+{
+    int16_t output = get_output();
+
+    if (output != amplitude) {
+        buffer.add_delta(time, output - amplitude);
+        amplitude = output;
+    }
+}
+
+
 /**
  * @brief      Timer for length counter, duty/wave/LSFR and envelope
  */
@@ -143,12 +195,12 @@ void Channel::volume_envelope()
 
 
 /**
- * @brief      Digital to analog converter
+ * @brief      Digital to analog converter, centered around 0
  */
 void Channel::dac()
 {
     if (dac_enabled) {
-        dac_output = -1 + (2 / 15.0) * output;
+        dac_output = (2 * output - 15) * SOUND_DAC_STEP;
     } else {
         enabled = false;
         dac_output = 0;
@@ -323,4 +375,7 @@ void Channel::deserialize(std::ifstream &file)
     file.read(reinterpret_cast<char*>(&dac_output), sizeof(int16_t));
 
     file.read(reinterpret_cast<char*>(&sequencer_clock), sizeof(size_t));
+
+    // Synthesis restarts from silence
+    amplitude = 0;
 }
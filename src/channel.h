@@ -3,6 +3,7 @@
 
 #include "mmu.h"
 #include "log.h"
+#include "blip_buffer.h"
 
 
 class DMG;
@@ -39,6 +40,11 @@ protected:
     bool dac_enabled;               // Controlled by upper 5 bit of NRX2
     int16_t dac_output;             // Output of DAC
 
+    // Synthesis
+    int16_t amplitude;              // Output given to the synthesis buffer so far
+
+    void record(BlipBuffer &buffer, size_t time);
+
 public:
     // Frame sequencer
     size_t sequencer_clock;         // Allow to determine when the frame sequencer should step
@@ -48,8 +54,12 @@ public:
     bool init();
     void reset();
     void update();
+    void render(BlipBuffer &buffer, size_t start, size_t target);
+    void resume(size_t clock);
 
     virtual void process() = 0;     // Channel related output generation
+    virtual size_t get_clock() = 0; // When process should be called next
+    virtual void set_clock(size_t clock) = 0;
     virtual void trigger() = 0;     // Channel is restarted
 
     void frame_sequencer();
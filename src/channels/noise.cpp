@@ -23,7 +23,7 @@ void Noise::reset()
     // LFSR (Linear Feedback Shift Register)
     lfsr_value = 0;
     lfsr_clock = 0;
-    divisor = 0;
+    divisor = 8;                // Same as NR43 at 0
     both_bit = false;
     clock_shift = 0;
 }
@@ -20,6 +20,8 @@ public:
 
     void reset();
     void process();
+    size_t get_clock() { return lfsr_clock; };
+    void set_clock(size_t clock) { lfsr_clock = clock; };
     void trigger();
 
     void frequency_sweep();
@@ -28,6 +28,8 @@ public:
 
     void reset();
     void process();
+    size_t get_clock() { return duty_clock; };
+    void set_clock(size_t clock) { duty_clock = clock; };
     void trigger();
 
     void frequency_sweep();
@@ -19,6 +19,8 @@ public:
 
     void reset();
     void process();
+    size_t get_clock() { return wave_clock; };
+    void set_clock(size_t clock) { wave_clock = clock; };
     void trigger();
 
     void frequency_sweep();
@@ -7,280 +7,323 @@
 #include "log.h"
 
 
-CPU::CPU() : mmu(nullptr)
+// Size in bytes of each opcode, operands included
+static const uint8_t opcode_lengths[MAX_OPCODES] = {
+//  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1,     // 0x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     // 1x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     // 2x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     // 3x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 4x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 5x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 6x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 7x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 8x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 9x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // Ax
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // Bx
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,     // Cx
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1,     // Dx
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,     // Ex
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,     // Fx
+};
+
+
+CPU::CPU() :
+    mmu(nullptr), code_cache(CODE_CACHE_SIZE), code_version(0), instruction(&decoded),
+    lazy_op(LAZY_FLAGS_NONE)
 {
+    flush_code_cache();
+
+    // CB opcodes all follow the same pattern
+    set_callbacks_CB<0x00>();
+
     // CPU opcode assingation
     l_callback[0x00] = &CPU::nop;
-    l_callback[0x01] = &CPU::ld;
-    l_callback[0x02] = &CPU::ld;
-    l_callback[0x03] = &CPU::inc;
-    l_callback[0x04] = &CPU::inc;
-    l_callback[0x05] = &CPU::dec;
-    l_callback[0x06] = &CPU::ld;
-    l_callback[0x07] = &CPU::rxa;
-    l_callback[0x08] = &CPU::ld;
-    l_callback[0x09] = &CPU::add;
-    l_callback[0x0A] = &CPU::ld;
-    l_callback[0x0B] = &CPU::dec;
-    l_callback[0x0C] = &CPU::inc;
-    l_callback[0x0D] = &CPU::dec;
-    l_callback[0x0E] = &CPU::ld;
-    l_callback[0x0F] = &CPU::rxa;
+    l_callback[0x01] = &CPU::ld<0x01>;
+    l_callback[0x02] = &CPU::ld<0x02>;
+    l_callback[0x03] = &CPU::inc<0x03>;
+    l_callback[0x04] = &CPU::inc<0x04>;
+    l_callback[0x05] = &CPU::dec<0x05>;
+    l_callback[0x06] = &CPU::ld<0x06>;
+    l_callback[0x07] = &CPU::rxa<0x07>;
+    l_callback[0x08] = &CPU::ld<0x08>;
+    l_callback[0x09] = &CPU::add<0x09>;
+    l_callback[0x0A] = &CPU::ld<0x0A>;
+    l_callback[0x0B] = &CPU::dec<0x0B>;
+    l_callback[0x0C] = &CPU::inc<0x0C>;
+    l_callback[0x0D] = &CPU::dec<0x0D>;
+    l_callback[0x0E] = &CPU::ld<0x0E>;
+    l_callback[0x0F] = &CPU::rxa<0x0F>;
 
     l_callback[0x10] = &CPU::stop;
-    l_callback[0x11] = &CPU::ld;
-    l_callback[0x12] = &CPU::ld;
-    l_callback[0x13] = &CPU::inc;
-    l_callback[0x14] = &CPU::inc;
-    l_callback[0x15] = &CPU::dec;
-    l_callback[0x16] = &CPU::ld;
-    l_callback[0x17] = &CPU::rxa;
-    l_callback[0x18] = &CPU::jr;
-    l_callback[0x19] = &CPU::add;
-    l_callback[0x1A] = &CPU::ld;
-    l_callback[0x1B] = &CPU::dec;
-    l_callback[0x1C] = &CPU::inc;
-    l_callback[0x1D] = &CPU::dec;
-    l_callback[0x1E] = &CPU::ld;
-    l_callback[0x1F] = &CPU::rxa;
-
-    l_callback[0x20] = &CPU::jr;
-    l_callback[0x21] = &CPU::ld;
-    l_callback[0x22] = &CPU::ld;
-    l_callback[0x23] = &CPU::inc;
-    l_callback[0x24] = &CPU::inc;
-    l_callback[0x25] = &CPU::dec;
-    l_callback[0x26] = &CPU::ld;
+    l_callback[0x11] = &CPU::ld<0x11>;
+    l_callback[0x12] = &CPU::ld<0x12>;
+    l_callback[0x13] = &CPU::inc<0x13>;
+    l_callback[0x14] = &CPU::inc<0x14>;
+    l_callback[0x15] = &CPU::dec<0x15>;
+    l_callback[0x16] = &CPU::ld<0x16>;
+    l_callback[0x17] = &CPU::rxa<0x17>;
+    l_callback[0x18] = &CPU::jr<0x18>;
+    l_callback[0x19] = &CPU::add<0x19>;
+    l_callback[0x1A] = &CPU::ld<0x1A>;
+    l_callback[0x1B] = &CPU::dec<0x1B>;
+    l_callback[0x1C] = &CPU::inc<0x1C>;
+    l_callback[0x1D] = &CPU::dec<0x1D>;
+    l_callback[0x1E] = &CPU::ld<0x1E>;
+    l_callback[0x1F] = &CPU::rxa<0x1F>;
+
+    l_callback[0x20] = &CPU::jr<0x20>;
+    l_callback[0x21] = &CPU::ld<0x21>;
+    l_callback[0x22] = &CPU::ld<0x22>;
+    l_callback[0x23] = &CPU::inc<0x23>;
+    l_callback[0x24] = &CPU::inc<0x24>;
+    l_callback[0x25] = &CPU::dec<0x25>;
+    l_callback[0x26] = &CPU::ld<0x26>;
     l_callback[0x27] = &CPU::daa;
-    l_callback[0x28] = &CPU::jr;
-    l_callback[0x29] = &CPU::add;
-    l_callback[0x2A] = &CPU::ld;
-    l_callback[0x2B] = &CPU::dec;
-    l_callback[0x2C] = &CPU::inc;
-    l_callback[0x2D] = &CPU::dec;
-    l_callback[0x2E] = &CPU::ld;
+    l_callback[0x28] = &CPU::jr<0x28>;
+    l_callback[0x29] = &CPU::add<0x29>;
+    l_callback[0x2A] = &CPU::ld<0x2A>;
+    l_callback[0x2B] = &CPU::dec<0x2B>;
+    l_callback[0x2C] = &CPU::inc<0x2C>;
+    l_callback[0x2D] = &CPU::dec<0x2D>;
+    l_callback[0x2E] = &CPU::ld<0x2E>;
     l_callback[0x2F] = &CPU::cpl;
 
-    l_callback[0x30] = &CPU::jr;
-    l_callback[0x31] = &CPU::ld;
-    l_callback[0x32] = &CPU::ld;
-    l_callback[0x33] = &CPU::inc;
-    l_callback[0x34] = &CPU::inc;
-    l_callback[0x35] = &CPU::dec;
-    l_callback[0x36] = &CPU::ld;
+    l_callback[0x30] = &CPU::jr<0x30>;
+    l_callback[0x31] = &CPU::ld<0x31>;
+    l_callback[0x32] = &CPU::ld<0x32>;
+    l_callback[0x33] = &CPU::inc<0x33>;
+    l_callback[0x34] = &CPU::inc<0x34>;
+    l_callback[0x35] = &CPU::dec<0x35>;
+    l_callback[0x36] = &CPU::ld<0x36>;
     l_callback[0x37] = &CPU::scf;
-    l_callback[0x38] = &CPU::jr;
-    l_callback[0x39] = &CPU::add;
-    l_callback[0x3A] = &CPU::ld;
-    l_callback[0x3B] = &CPU::dec;
-    l_callback[0x3C] = &CPU::inc;
-    l_callback[0x3D] = &CPU::dec;
-    l_callback[0x3E] = &CPU::ld;
+    l_callback[0x38] = &CPU::jr<0x38>;
+    l_callback[0x39] = &CPU::add<0x39>;
+    l_callback[0x3A] = &CPU::ld<0x3A>;
+    l_callback[0x3B] = &CPU::dec<0x3B>;
+    l_callback[0x3C] = &CPU::inc<0x3C>;
+    l_callback[0x3D] = &CPU::dec<0x3D>;
+    l_callback[0x3E] = &CPU::ld<0x3E>;
     l_callback[0x3F] = &CPU::ccf;
 
-    l_callback[0x40] = &CPU::ld;
-    l_callback[0x41] = &CPU::ld;
-    l_callback[0x42] = &CPU::ld;
-    l_callback[0x43] = &CPU::ld;
-    l_callback[0x44] = &CPU::ld;
-    l_callback[0x45] = &CPU::ld;
-    l_callback[0x46] = &CPU::ld;
-    l_callback[0x47] = &CPU::ld;
-    l_callback[0x48] = &CPU::ld;
-    l_callback[0x49] = &CPU::ld;
-    l_callback[0x4A] = &CPU::ld;
-    l_callback[0x4B] = &CPU::ld;
-    l_callback[0x4C] = &CPU::ld;
-    l_callback[0x4D] = &CPU::ld;
-    l_callback[0x4E] = &CPU::ld;
-    l_callback[0x4F] = &CPU::ld;
-
-    l_callback[0x50] = &CPU::ld;
-    l_callback[0x51] = &CPU::ld;
-    l_callback[0x52] = &CPU::ld;
-    l_callback[0x53] = &CPU::ld;
-    l_callback[0x54] = &CPU::ld;
-    l_callback[0x55] = &CPU::ld;
-    l_callback[0x56] = &CPU::ld;
-    l_callback[0x57] = &CPU::ld;
-    l_callback[0x58] = &CPU::ld;
-    l_callback[0x59] = &CPU::ld;
-    l_callback[0x5A] = &CPU::ld;
-    l_callback[0x5B] = &CPU::ld;
-    l_callback[0x5C] = &CPU::ld;
-    l_callback[0x5D] = &CPU::ld;
-    l_callback[0x5E] = &CPU::ld;
-    l_callback[0x5F] = &CPU::ld;
-
-    l_callback[0x60] = &CPU::ld;
-    l_callback[0x61] = &CPU::ld;
-    l_callback[0x62] = &CPU::ld;
-    l_callback[0x63] = &CPU::ld;
-    l_callback[0x64] = &CPU::ld;
-    l_callback[0x65] = &CPU::ld;
-    l_callback[0x66] = &CPU::ld;
-    l_callback[0x67] = &CPU::ld;
-    l_callback[0x68] = &CPU::ld;
-    l_callback[0x69] = &CPU::ld;
-    l_callback[0x6A] = &CPU::ld;
-    l_callback[0x6B] = &CPU::ld;
-    l_callback[0x6C] = &CPU::ld;
-    l_callback[0x6D] = &CPU::ld;
-    l_callback[0x6E] = &CPU::ld;
-    l_callback[0x6F] = &CPU::ld;
-
-    l_callback[0x70] = &CPU::ld;
-    l_callback[0x71] = &CPU::ld;
-    l_callback[0x72] = &CPU::ld;
-    l_callback[0x73] = &CPU::ld;
-    l_callback[0x74] = &CPU::ld;
-    l_callback[0x75] = &CPU::ld;
+    l_callback[0x40] = &CPU::ld<0x40>;
+    l_callback[0x41] = &CPU::ld<0x41>;
+    l_callback[0x42] = &CPU::ld<0x42>;
+    l_callback[0x43] = &CPU::ld<0x43>;
+    l_callback[0x44] = &CPU::ld<0x44>;
+    l_callback[0x45] = &CPU::ld<0x45>;
+    l_callback[0x46] = &CPU::ld<0x46>;
+    l_callback[0x47] = &CPU::ld<0x47>;
+    l_callback[0x48] = &CPU::ld<0x48>;
+    l_callback[0x49] = &CPU::ld<0x49>;
+    l_callback[0x4A] = &CPU::ld<0x4A>;
+    l_callback[0x4B] = &CPU::ld<0x4B>;
+    l_callback[0x4C] = &CPU::ld<0x4C>;
+    l_callback[0x4D] = &CPU::ld<0x4D>;
+    l_callback[0x4E] = &CPU::ld<0x4E>;
+    l_callback[0x4F] = &CPU::ld<0x4F>;
+
+    l_callback[0x50] = &CPU::ld<0x50>;
+    l_callback[0x51] = &CPU::ld<0x51>;
+    l_callback[0x52] = &CPU::ld<0x52>;
+    l_callback[0x53] = &CPU::ld<0x53>;
+    l_callback[0x54] = &CPU::ld<0x54>;
+    l_callback[0x55] = &CPU::ld<0x55>;
+    l_callback[0x56] = &CPU::ld<0x56>;
+    l_callback[0x57] = &CPU::ld<0x57>;
+    l_callback[0x58] = &CPU::ld<0x58>;
+    l_callback[0x59] = &CPU::ld<0x59>;
+    l_callback[0x5A] = &CPU::ld<0x5A>;
+    l_callback[0x5B] = &CPU::ld<0x5B>;
+    l_callback[0x5C] = &CPU::ld<0x5C>;
+    l_callback[0x5D] = &CPU::ld<0x5D>;
+    l_callback[0x5E] = &CPU::ld<0x5E>;
+    l_callback[0x5F] = &CPU::ld<0x5F>;
+
+    l_callback[0x60] = &CPU::ld<0x60>;
+    l_callback[0x61] = &CPU::ld<0x61>;
+    l_callback[0x62] = &CPU::ld<0x62>;
+    l_callback[0x63] = &CPU::ld<0x63>;
+    l_callback[0x64] = &CPU::ld<0x64>;
+    l_callback[0x65] = &CPU::ld<0x65>;
+    l_callback[0x66] = &CPU::ld<0x66>;
+    l_callback[0x67] = &CPU::ld<0x67>;
+    l_callback[0x68] = &CPU::ld<0x68>;
+    l_callback[0x69] = &CPU::ld<0x69>;
+    l_callback[0x6A] = &CPU::ld<0x6A>;
+    l_callback[0x6B] = &CPU::ld<0x6B>;
+    l_callback[0x6C] = &CPU::ld<0x6C>;
+    l_callback[0x6D] = &CPU::ld<0x6D>;
+    l_callback[0x6E] = &CPU::ld<0x6E>;
+    l_callback[0x6F] = &CPU::ld<0x6F>;
+
+    l_callback[0x70] = &CPU::ld<0x70>;
+    l_callback[0x71] = &CPU::ld<0x71>;
+    l_callback[0x72] = &CPU::ld<0x72>;
+    l_callback[0x73] = &CPU::ld<0x73>;
+    l_callback[0x74] = &CPU::ld<0x74>;
+    l_callback[0x75] = &CPU::ld<0x75>;
     l_callback[0x76] = &CPU::halt;
-    l_callback[0x77] = &CPU::ld;
-    l_callback[0x78] = &CPU::ld;
-    l_callback[0x79] = &CPU::ld;
-    l_callback[0x7A] = &CPU::ld;
-    l_callback[0x7B] = &CPU::ld;
-    l_callback[0x7C] = &CPU::ld;
-    l_callback[0x7D] = &CPU::ld;
-    l_callback[0x7E] = &CPU::ld;
-    l_callback[0x7F] = &CPU::ld;
-
-    l_callback[0x80] = &CPU::add;
-    l_callback[0x81] = &CPU::add;
-    l_callback[0x82] = &CPU::add;
-    l_callback[0x83] = &CPU::add;
-    l_callback[0x84] = &CPU::add;
-    l_callback[0x85] = &CPU::add;
-    l_callback[0x86] = &CPU::add;
-    l_callback[0x87] = &CPU::add;
-    l_callback[0x88] = &CPU::add;
-    l_callback[0x89] = &CPU::add;
-    l_callback[0x8A] = &CPU::add;
-    l_callback[0x8B] = &CPU::add;
-    l_callback[0x8C] = &CPU::add;
-    l_callback[0x8D] = &CPU::add;
-    l_callback[0x8E] = &CPU::add;
-    l_callback[0x8F] = &CPU::add;
-
-    l_callback[0x90] = &CPU::sub;
-    l_callback[0x91] = &CPU::sub;
-    l_callback[0x92] = &CPU::sub;
-    l_callback[0x93] = &CPU::sub;
-    l_callback[0x94] = &CPU::sub;
-    l_callback[0x95] = &CPU::sub;
-    l_callback[0x96] = &CPU::sub;
-    l_callback[0x97] = &CPU::sub;
-    l_callback[0x98] = &CPU::sub;
-    l_callback[0x99] = &CPU::sub;
-    l_callback[0x9A] = &CPU::sub;
-    l_callback[0x9B] = &CPU::sub;
-    l_callback[0x9C] = &CPU::sub;
-    l_callback[0x9D] = &CPU::sub;
-    l_callback[0x9E] = &CPU::sub;
-    l_callback[0x9F] = &CPU::sub;
-
-    l_callback[0xA0] = &CPU::or_xor_and_cp;
-    l_callback[0xA1] = &CPU::or_xor_and_cp;
-    l_callback[0xA2] = &CPU::or_xor_and_cp;
-    l_callback[0xA3] = &CPU::or_xor_and_cp;
-    l_callback[0xA4] = &CPU::or_xor_and_cp;
-    l_callback[0xA5] = &CPU::or_xor_and_cp;
-    l_callback[0xA6] = &CPU::or_xor_and_cp;
-    l_callback[0xA7] = &CPU::or_xor_and_cp;
-    l_callback[0xA8] = &CPU::or_xor_and_cp;
-    l_callback[0xA9] = &CPU::or_xor_and_cp;
-    l_callback[0xAA] = &CPU::or_xor_and_cp;
-    l_callback[0xAB] = &CPU::or_xor_and_cp;
-    l_callback[0xAC] = &CPU::or_xor_and_cp;
-    l_callback[0xAD] = &CPU::or_xor_and_cp;
-    l_callback[0xAE] = &CPU::or_xor_and_cp;
-    l_callback[0xAF] = &CPU::or_xor_and_cp;
-
-    l_callback[0xB0] = &CPU::or_xor_and_cp;
-    l_callback[0xB1] = &CPU::or_xor_and_cp;
-    l_callback[0xB2] = &CPU::or_xor_and_cp;
-    l_callback[0xB3] = &CPU::or_xor_and_cp;
-    l_callback[0xB4] = &CPU::or_xor_and_cp;
-    l_callback[0xB5] = &CPU::or_xor_and_cp;
-    l_callback[0xB6] = &CPU::or_xor_and_cp;
-    l_callback[0xB7] = &CPU::or_xor_and_cp;
-    l_callback[0xB8] = &CPU::or_xor_and_cp;
-    l_callback[0xB9] = &CPU::or_xor_and_cp;
-    l_callback[0xBA] = &CPU::or_xor_and_cp;
-    l_callback[0xBB] = &CPU::or_xor_and_cp;
-    l_callback[0xBC] = &CPU::or_xor_and_cp;
-    l_callback[0xBD] = &CPU::or_xor_and_cp;
-    l_callback[0xBE] = &CPU::or_xor_and_cp;
-    l_callback[0xBF] = &CPU::or_xor_and_cp;
-
-    l_callback[0xC0] = &CPU::ret;
-    l_callback[0xC1] = &CPU::pop;
-    l_callback[0xC2] = &CPU::jp;
-    l_callback[0xC3] = &CPU::jp;
-    l_callback[0xC4] = &CPU::call;
-    l_callback[0xC5] = &CPU::push;
-    l_callback[0xC6] = &CPU::add;
-    l_callback[0xC7] = &CPU::rst;
-    l_callback[0xC8] = &CPU::ret;
-    l_callback[0xC9] = &CPU::ret;
-    l_callback[0xCA] = &CPU::jp;
+    l_callback[0x77] = &CPU::ld<0x77>;
+    l_callback[0x78] = &CPU::ld<0x78>;
+    l_callback[0x79] = &CPU::ld<0x79>;
+    l_callback[0x7A] = &CPU::ld<0x7A>;
+    l_callback[0x7B] = &CPU::ld<0x7B>;
+    l_callback[0x7C] = &CPU::ld<0x7C>;
+    l_callback[0x7D] = &CPU::ld<0x7D>;
+    l_callback[0x7E] = &CPU::ld<0x7E>;
+    l_callback[0x7F] = &CPU::ld<0x7F>;
+
+    l_callback[0x80] = &CPU::add<0x80>;
+    l_callback[0x81] = &CPU::add<0x81>;
+    l_callback[0x82] = &CPU::add<0x82>;
+    l_callback[0x83] = &CPU::add<0x83>;
+    l_callback[0x84] = &CPU::add<0x84>;
+    l_callback[0x85] = &CPU::add<0x85>;
+    l_callback[0x86] = &CPU::add<0x86>;
+    l_callback[0x87] = &CPU::add<0x87>;
+    l_callback[0x88] = &CPU::add<0x88>;
+    l_callback[0x89] = &CPU::add<0x89>;
+    l_callback[0x8A] = &CPU::add<0x8A>;
+    l_callback[0x8B] = &CPU::add<0x8B>;
+    l_callback[0x8C] = &CPU::add<0x8C>;
+    l_callback[0x8D] = &CPU::add<0x8D>;
+    l_callback[0x8E] = &CPU::add<0x8E>;
+    l_callback[0x8F] = &CPU::add<0x8F>;
+
+    l_callback[0x90] = &CPU::sub<0x90>;
+    l_callback[0x91] = &CPU::sub<0x91>;
+    l_callback[0x92] = &CPU::sub<0x92>;
+    l_callback[0x93] = &CPU::sub<0x93>;
+    l_callback[0x94] = &CPU::sub<0x94>;
+    l_callback[0x95] = &CPU::sub<0x95>;
+    l_callback[0x96] = &CPU::sub<0x96>;
+    l_callback[0x97] = &CPU::sub<0x97>;
+    l_callback[0x98] = &CPU::sub<0x98>;
+    l_callback[0x99] = &CPU::sub<0x99>;
+    l_callback[0x9A] = &CPU::sub<0x9A>;
+    l_callback[0x9B] = &CPU::sub<0x9B>;
+    l_callback[0x9C] = &CPU::sub<0x9C>;
+    l_callback[0x9D] = &CPU::sub<0x9D>;
+    l_callback[0x9E] = &CPU::sub<0x9E>;
+    l_callback[0x9F] = &CPU::sub<0x9F>;
+
+    l_callback[0xA0] = &CPU::or_xor_and_cp<0xA0>;
+    l_callback[0xA1] = &CPU::or_xor_and_cp<0xA1>;
+    l_callback[0xA2] = &CPU::or_xor_and_cp<0xA2>;
+    l_callback[0xA3] = &CPU::or_xor_and_cp<0xA3>;
+    l_callback[0xA4] = &CPU::or_xor_and_cp<0xA4>;
+    l_callback[0xA5] = &CPU::or_xor_and_cp<0xA5>;
+    l_callback[0xA6] = &CPU::or_xor_and_cp<0xA6>;
+    l_callback[0xA7] = &CPU::or_xor_and_cp<0xA7>;
+    l_callback[0xA8] = &CPU::or_xor_and_cp<0xA8>;
+    l_callback[0xA9] = &CPU::or_xor_and_cp<0xA9>;
+    l_callback[0xAA] = &CPU::or_xor_and_cp<0xAA>;
+    l_callback[0xAB] = &CPU::or_xor_and_cp<0xAB>;
+    l_callback[0xAC] = &CPU::or_xor_and_cp<0xAC>;
+    l_callback[0xAD] = &CPU::or_xor_and_cp<0xAD>;
+    l_callback[0xAE] = &CPU::or_xor_and_cp<0xAE>;
+    l_callback[0xAF] = &CPU::or_xor_and_cp<0xAF>;
+
+    l_callback[0xB0] = &CPU::or_xor_and_cp<0xB0>;
+    l_callback[0xB1] = &CPU::or_xor_and_cp<0xB1>;
+    l_callback[0xB2] = &CPU::or_xor_and_cp<0xB2>;
+    l_callback[0xB3] = &CPU::or_xor_and_cp<0xB3>;
+    l_callback[0xB4] = &CPU::or_xor_and_cp<0xB4>;
+    l_callback[0xB5] = &CPU::or_xor_and_cp<0xB5>;
+    l_callback[0xB6] = &CPU::or_xor_and_cp<0xB6>;
+    l_callback[0xB7] = &CPU::or_xor_and_cp<0xB7>;
+    l_callback[0xB8] = &CPU::or_xor_and_cp<0xB8>;
+    l_callback[0xB9] = &CPU::or_xor_and_cp<0xB9>;
+    l_callback[0xBA] = &CPU::or_xor_and_cp<0xBA>;
+    l_callback[0xBB] = &CPU::or_xor_and_cp<0xBB>;
+    l_callback[0xBC] = &CPU::or_xor_and_cp<0xBC>;
+    l_callback[0xBD] = &CPU::or_xor_and_cp<0xBD>;
+    l_callback[0xBE] = &CPU::or_xor_and_cp<0xBE>;
+    l_callback[0xBF] = &CPU::or_xor_and_cp<0xBF>;
+
+    l_callback[0xC0] = &CPU::ret<0xC0>;
+    l_callback[0xC1] = &CPU::pop<0xC1>;
+    l_callback[0xC2] = &CPU::jp<0xC2>;
+    l_callback[0xC3] = &CPU::jp<0xC3>;
+    l_callback[0xC4] = &CPU::call<0xC4>;
+    l_callback[0xC5] = &CPU::push<0xC5>;
+    l_callback[0xC6] = &CPU::add<0xC6>;
+    l_callback[0xC7] = &CPU::rst<0xC7>;
+    l_callback[0xC8] = &CPU::ret<0xC8>;
+    l_callback[0xC9] = &CPU::ret<0xC9>;
+    l_callback[0xCA] = &CPU::jp<0xCA>;
     l_callback[0xCB] = &CPU::prefix_CB;
-    l_callback[0xCC] = &CPU::call;
-    l_callback[0xCD] = &CPU::call;
-    l_callback[0xCE] = &CPU::add;
-    l_callback[0xCF] = &CPU::rst;
-
-    l_callback[0xD0] = &CPU::ret;
-    l_callback[0xD1] = &CPU::pop;
-    l_callback[0xD2] = &CPU::jp;
+    l_callback[0xCC] = &CPU::call<0xCC>;
+    l_callback[0xCD] = &CPU::call<0xCD>;
+    l_callback[0xCE] = &CPU::add<0xCE>;
+    l_callback[0xCF] = &CPU::rst<0xCF>;
+
+    l_callback[0xD0] = &CPU::ret<0xD0>;
+    l_callback[0xD1] = &CPU::pop<0xD1>;
+    l_callback[0xD2] = &CPU::jp<0xD2>;
     l_callback[0xD3] = NULL;
-    l_callback[0xD4] = &CPU::call;
-    l_callback[0xD5] = &CPU::push;
-    l_callback[0xD6] = &CPU::sub;
-    l_callback[0xD7] = &CPU::rst;
-    l_callback[0xD8] = &CPU::ret;
-    l_callback[0xD9] = &CPU::ret;
-    l_callback[0xDA] = &CPU::jp;
+    l_callback[0xD4] = &CPU::call<0xD4>;
+    l_callback[0xD5] = &CPU::push<0xD5>;
+    l_callback[0xD6] = &CPU::sub<0xD6>;
+    l_callback[0xD7] = &CPU::rst<0xD7>;
+    l_callback[0xD8] = &CPU::ret<0xD8>;
+    l_callback[0xD9] = &CPU::ret<0xD9>;
+    l_callback[0xDA] = &CPU::jp<0xDA>;
     l_callback[0xDB] = NULL;
-    l_callback[0xDC] = &CPU::call;
+    l_callback[0xDC] = &CPU::call<0xDC>;
     l_callback[0xDD] = NULL;
-    l_callback[0xDE] = &CPU::sub;
-    l_callback[0xDF] = &CPU::rst;
+    l_callback[0xDE] = &CPU::sub<0xDE>;
+    l_callback[0xDF] = &CPU::rst<0xDF>;
 
-    l_callback[0xE0] = &CPU::ld;
-    l_callback[0xE1] = &CPU::pop;
-    l_callback[0xE2] = &CPU::ld;
+    l_callback[0xE0] = &CPU::ld<0xE0>;
+    l_callback[0xE1] = &CPU::pop<0xE1>;
+    l_callback[0xE2] = &CPU::ld<0xE2>;
     l_callback[0xE3] = NULL;
     l_callback[0xE4] = NULL;
-    l_callback[0xE5] = &CPU::push;
-    l_callback[0xE6] = &CPU::or_xor_and_cp;
-    l_callback[0xE7] = &CPU::rst;
-    l_callback[0xE8] = &CPU::add;
+    l_callback[0xE5] = &CPU::push<0xE5>;
+    l_callback[0xE6] = &CPU::or_xor_and_cp<0xE6>;
+    l_callback[0xE7] = &CPU::rst<0xE7>;
+    l_callback[0xE8] = &CPU::add<0xE8>;
     l_callback[0xE9] = &CPU::jp_hl;
-    l_callback[0xEA] = &CPU::ld;
+    l_callback[0xEA] = &CPU::ld<0xEA>;
     l_callback[0xEB] = NULL;
     l_callback[0xEC] = NULL;
     l_callback[0xED] = NULL;
-    l_callback[0xEE] = &CPU::or_xor_and_cp;
-    l_callback[0xEF] = &CPU::rst;
+    l_callback[0xEE] = &CPU::or_xor_and_cp<0xEE>;
+    l_callback[0xEF] = &CPU::rst<0xEF>;
 
-    l_callback[0xF0] = &CPU::ld;
-    l_callback[0xF1] = &CPU::pop;
-    l_callback[0xF2] = &CPU::ld;
-    l_callback[0xF3] = &CPU::ei_di;
+    l_callback[0xF0] = &CPU::ld<0xF0>;
+    l_callback[0xF1] = &CPU::pop<0xF1>;
+    l_callback[0xF2] = &CPU::ld<0xF2>;
+    l_callback[0xF3] = &CPU::ei_di<0xF3>;
     l_callback[0xF4] = NULL;
-    l_callback[0xF5] = &CPU::push;
-    l_callback[0xF6] = &CPU::or_xor_and_cp;
-    l_callback[0xF7] = &CPU::rst;
-    l_callback[0xF8] = &CPU::ld;
-    l_callback[0xF9] = &CPU::ld;
-    l_callback[0xFA] = &CPU::ld;
-    l_callback[0xFB] = &CPU::ei_di;
+    l_callback[0xF5] = &CPU::push<0xF5>;
+    l_callback[0xF6] = &CPU::or_xor_and_cp<0xF6>;
+    l_callback[0xF7] = &CPU::rst<0xF7>;
+    l_callback[0xF8] = &CPU::ld<0xF8>;
+    l_callback[0xF9] = &CPU::ld<0xF9>;
+    l_callback[0xFA] = &CPU::ld<0xFA>;
+    l_callback[0xFB] = &CPU::ei_di<0xFB>;
     l_callback[0xFC] = NULL;
     l_callback[0xFD] = NULL;
-    l_callback[0xFE] = &CPU::or_xor_and_cp;
-    l_callback[0xFF] = &CPU::rst;
+    l_callback[0xFE] = &CPU::or_xor_and_cp<0xFE>;
+    l_callback[0xFF] = &CPU::rst<0xFF>;
+}
+
+
+/**
+ * @brief      Fills the CB table with one handler per opcode, from the given one
+ */
+template <uint8_t opcode>
+void CPU::set_callbacks_CB()
+{
+    l_callback_CB[opcode] = &CPU::CB<opcode>;
+
+    if constexpr (opcode < MAX_OPCODES - 1) {
+        set_callbacks_CB<opcode + 1>();
+    }
 }
 
 
@@ -300,7 +343,7 @@ void CPU::reset()
     clock = 0;
 
     reg[A] = 0x01;
-    reg[F] = 0xB0;
+    set_F(0xB0);
     reg[B] = 0x00;
     reg[C] = 0x13;
     reg[D] = 0x00;
@@ -314,6 +357,9 @@ void CPU::reset()
     IME = false;
     halted = false;
     halt_bug = false;
+
+    ei_requested = false;
+    ei_delay = 0;
 }
 
 /**
@@ -332,12 +378,12 @@ bool CPU::step()
         return false;
     }
 
-    uint8_t opcode = mmu->get(PC);
+    const cpu_instruction *fetched = fetch();
 
     // Some instructions are not meant to do anything,
     // this will stall until reboot
-    if (l_callback[opcode] == nullptr) {
-        error("Not Implemented PC: 0x%04X\tOpcode: 0x%02X\n", PC, opcode);
+    if (fetched->callback == nullptr) {
+        error("Not Implemented PC: 0x%04X\tOpcode: 0x%02X\n", PC, fetched->opcode);
         IME = false;
         return false;
     }
@@ -345,9 +391,14 @@ bool CPU::step()
     if (halt_bug) {
         PC -= 1;
         halt_bug = false;
+
+        // Byte after HALT is read twice, operands are shifted
+        decode(PC, fetched->opcode, &decoded);
+        fetched = &decoded;
     }
 
-    (*this.*l_callback[opcode])(opcode);
+    instruction = fetched;
+    (*this.*instruction->callback)(instruction->opcode);
 
     // Handle EI delay
     if (ei_requested) {
@@ -363,6 +414,94 @@ bool CPU::step()
 }
 
 
+/**
+ * @brief      Gives the instruction pointed by PC
+ *
+ * Instructions in cartridge ROM are decoded once and kept until the bank they
+ * come from is switched out. Anything else (boot, RAM) is decoded every time
+ * so writes to executed RAM can never leave stale instructions.
+ * @return     The instruction, valid until next fetch
+ */
+const cpu_instruction *CPU::fetch()
+{
+    const uint8_t *code = mmu->get_code(PC);
+    if (code == nullptr) {
+        decode(PC, mmu->get(PC), &decoded);
+        return &decoded;
+    }
+
+    // New ROM or state loaded
+    if (mmu->get_code_version() != code_version) {
+        flush_code_cache();
+        code_version = mmu->get_code_version();
+    }
+
+    // Source tells both address and bank, mismatch if bank was switched
+    cpu_instruction *cached = &code_cache[PC];
+    if (cached->source == code) {
+        return cached;
+    }
+
+    uint8_t opcode = code[0];
+    size_t length = opcode_lengths[opcode];
+
+    // Next page might be from another bank
+    if ((PC & (MMU_PAGE_SIZE - 1)) + length > MMU_PAGE_SIZE) {
+        decode(PC, opcode, &decoded);
+        return &decoded;
+    }
+
+    cached->source = code;
+    cached->callback = l_callback[opcode];
+    cached->opcode = opcode;
+    cached->operand = 0;
+
+    if (length > 1) {
+        cached->operand = code[1];
+    }
+    if (length > 2) {
+        cached->operand |= code[2] << 8;
+    }
+
+    return cached;
+}
+
+
+/**
+ * @brief      Reads operands of the given opcode through the MMU
+ * @param[in]  address  The address of the opcode
+ * @param[in]  opcode   The opcode
+ * @param      result   The decoded instruction
+ */
+void CPU::decode(uint16_t address, uint8_t opcode, cpu_instruction *result)
+{
+    size_t length = opcode_lengths[opcode];
+
+    result->source = nullptr;
+    result->callback = l_callback[opcode];
+    result->opcode = opcode;
+    result->operand = 0;
+
+    if (length > 1) {
+        result->operand = mmu->get(address + 1);
+    }
+    if (length > 2) {
+        result->operand |= mmu->get(address + 2) << 8;
+    }
+}
+
+
+/**
+ * @brief      Forget every decoded instruction
+ */
+void CPU::flush_code_cache()
+{
+    for (size_t i=0; i<CODE_CACHE_SIZE; i++) {
+        code_cache[i].source = nullptr;
+    }
+}
+
+
 /**
  * @brief      Set the Flag register value
  * @param[in]  flag   The flag to set/unset
@@ -370,7 +509,7 @@ bool CPU::step()
  */
 void CPU::set_flag(size_t flag, bool value)
 {
-    reg[F] = set_bit(reg[F], flag, value) & 0xF0;
+    set_F(set_bit(get_F(), flag, value));
 }
 
 
@@ -381,7 +520,90 @@ void CPU::set_flag(size_t flag, bool value)
  */
 bool CPU::get_flag(size_t flag)
 {
-    return get_bit(reg[F], flag);
+    return get_bit(get_F(), flag);
+}
+
+
+/**
+ * @brief      Gives the Flag register, computing the flags of the last ALU operation
+ */
+uint8_t CPU::get_F()
+{
+    if (lazy_op == LAZY_FLAGS_NONE) {
+        return reg[F];
+    }
+
+    bool n = false;
+    bool h = false;
+
+    switch (lazy_op) {
+    case LAZY_FLAGS_ADD:
+        h = (lazy_a & 0x0F) + (lazy_b & 0x0F) + lazy_carry > 0x0F;
+        break;
+    case LAZY_FLAGS_SUB:
+        n = true;
+        h = (lazy_a & 0x0F) < (lazy_b & 0x0F) + lazy_carry;
+        break;
+    case LAZY_FLAGS_AND:
+        h = true;
+        break;
+    case LAZY_FLAGS_INC:
+        h = (lazy_result & 0x0F) == 0x00; // Went from 0xXF to 0xX0
+        break;
+    case LAZY_FLAGS_DEC:
+        n = true;
+        h = (lazy_result & 0x0F) == 0x0F; // Went from 0xX0 to 0xXF
+        break;
+    }
+
+    set_flags(lazy_result == 0, n, h, get_carry());
+
+    return reg[F];
+}
+
+
+/**
+ * @brief      Sets the Flag register, 4 lower bits remain at 0
+ */
+void CPU::set_F(uint8_t value)
+{
+    reg[F] = value & 0xF0;
+    lazy_op = LAZY_FLAGS_NONE;
+}
+
+
+/**
+ * @brief      Zero flag, without computing the other ones
+ */
+bool CPU::get_zero()
+{
+    if (lazy_op == LAZY_FLAGS_NONE) {
+        return get_bit(reg[F], FZ);
+    }
+
+    return lazy_result == 0;
+}
+
+
+/**
+ * @brief      Carry flag, without computing the other ones
+ */
+bool CPU::get_carry()
+{
+    switch (lazy_op) {
+    case LAZY_FLAGS_ADD:
+        return lazy_a + lazy_b + lazy_carry > 0xFF;     // Overflow
+    case LAZY_FLAGS_SUB:
+        return lazy_a < lazy_b + lazy_carry;            // Underflow
+    case LAZY_FLAGS_AND:
+    case LAZY_FLAGS_OR:
+        return false;
+    case LAZY_FLAGS_INC:
+    case LAZY_FLAGS_DEC:
+        return lazy_carry;
+    default:
+        return get_bit(reg[F], FC);
+    }
 }
 
 /**
@@ -402,56 +624,59 @@ uint16_t CPU::reg16(size_t i)
  *             Most opcodes operates on the same targets. First DEC in the
  *             opcodes will always be B, same for ADD, and so on. This function
  *             uses this order to simplify targets identification.
- * @param[in]  index  The index
+ * @tparam     index  The index, cannot be 6 (HL)
  * @return     The target address.
  */
-uint8_t *CPU::get_target(size_t index)
+template <size_t index>
+uint8_t *CPU::get_target()
 {
-    uint8_t *l_address[] = {
-        &reg[B],
-        &reg[C],
-        &reg[D],
-        &reg[E],
-        &reg[H],
-        &reg[L],
-        NULL,       // Can never happen (cleaner way to restrain that?)
-        &reg[A]
-    };
+    static_assert(index != 6, "(HL) is not a register");
 
-    return l_address[index];
+    constexpr size_t l_registers[] = { B, C, D, E, H, L, 0, A };
+
+    return &reg[l_registers[index]];
 }
-uint8_t CPU::get_target_value(size_t index)
-{
-    uint8_t l_address[] = {
-        reg[B],
-        reg[C],
-        reg[D],
-        reg[E],
-        reg[H],
-        reg[L],
-        mmu->get(reg16(HL)),
-        reg[A]
-    };
 
-    return l_address[index];
+template <size_t index>
+uint8_t CPU::get_target_value()
+{
+    if constexpr (index == 6) {
+        return mmu->get(reg16(HL));
+    } else {
+        return *get_target<index>();
+    }
 }
 
 
 /**
  * @brief      Same as get_target but for 16bit registers
- * @param[in]  index  The index
+ * @tparam     index  The index
  * @return     The target 16.
  */
-uint8_t *CPU::get_target16(size_t index)
+template <size_t index>
+uint8_t *CPU::get_target16()
 {
-    uint8_t *l_address[] = {
-        &reg[BC],
-        &reg[DE],
-        &reg[HL],
-        &reg[SP]
-    };
+    constexpr size_t l_registers[] = { BC, DE, HL, SP };
+
+    return &reg[l_registers[index]];
+}
 
-    return l_address[index];
+
+/**
+ * @brief      Condition of JR, JP, CALL and RET opcodes (NZ, Z, NC, C)
+ * @tparam     opcode  The conditional opcode
+ * @return     true if the jump should happen
+ */
+template <uint8_t opcode>
+bool CPU::check_condition()
+{
+    constexpr bool expected = opcode & 0x08;
+
+    if constexpr (opcode & 0x10) {
+        return get_carry() == expected;
+    } else {
+        return get_zero() == expected;
+    }
 }
 
 // TODO: Simplify
@@ -495,9 +720,7 @@ void CPU::inc8(uint8_t *address)
 {
     *address = *address + 1;
 
-    set_flag(FZ, *address == 0);
-    set_flag(FN, 0);
-    set_flag(FH, (*address & 0x0F) == 0x00); // Went from 0xXF to 0xX0
+    defer_flags(LAZY_FLAGS_INC, 0, 0, *address, get_carry());
 }
 
 void CPU::inc8_mmu(uint16_t address)
@@ -505,18 +728,14 @@ void CPU::inc8_mmu(uint16_t address)
     uint8_t value = mmu->get(address) + 1;
     mmu->set(address, value);
 
-    set_flag(FZ, value == 0);
-    set_flag(FN, 0);
-    set_flag(FH, (value & 0x0F) == 0x00); // Went from 0xXF to 0xX0
+    defer_flags(LAZY_FLAGS_INC, 0, 0, value, get_carry());
 }
 
 void CPU::dec8(uint8_t *address)
 {
     *address = *address - 1;
 
-    set_flag(FZ, *address == 0);
-    set_flag(FN, 1);
-    set_flag(FH, (*address & 0x0F) == 0x0F); // Went from 0xX0 to 0xXF
+    defer_flags(LAZY_FLAGS_DEC, 0, 0, *address, get_carry());
 }
 
 void CPU::dec8_mmu(uint16_t address)
@@ -524,54 +743,46 @@ void CPU::dec8_mmu(uint16_t address)
     uint8_t value = mmu->get(address) - 1;
     mmu->set(address, value);
 
-    set_flag(FZ, value == 0);
-    set_flag(FN, 1);
-    set_flag(FH, (value & 0x0F) == 0x0F); // Went from 0xX0 to 0xXF
+    defer_flags(LAZY_FLAGS_DEC, 0, 0, value, get_carry());
 }
 
 /**
  * @brief      Handles ADD and ADC
  */
-void CPU::add8(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::add8()
 {
-    size_t target_index = opcode % 8;
-    uint8_t target = get_target_value(target_index);
+    uint8_t target;
 
     // ADD/ADC d8
-    if (opcode > 0xC0) {
-        target = mmu->get(PC + 1);
+    if constexpr (opcode > 0xC0) {
+        target = get_d8();
         PC += 2;
         clock += 8;
     }
     // (HL) case
-    else if (target_index == 6) {
+    else if constexpr (opcode % 8 == 6) {
+        target = get_target_value<6>();
         PC += 1;
         clock += 8;
     } else {
+        target = get_target_value<opcode % 8>();
         PC += 1;
         clock += 4;
     }
 
-    uint16_t value = target;
+    bool carry = false;
 
     // ADC
-    if (opcode >= 0x88 && opcode != 0xC6) {
-        value += get_bit(reg[F], FC);
+    if constexpr (opcode >= 0x88 && opcode != 0xC6) {
+        carry = get_carry();
     }
 
-    uint16_t result = reg[A] + value;
-
-    // FH set when adding carry flag
-    bool half_carry = (target & 0xF0) < (value & 0xFFF0);
-
-    half_carry |= (reg[A] & 0x0F) + (value & 0x0F) > 0x0F;
+    uint8_t result = reg[A] + target + carry;
 
-    reg[A] = (uint8_t) result;
+    defer_flags(LAZY_FLAGS_ADD, reg[A], target, result, carry);
 
-    set_flag(FZ, reg[A] == 0);
-    set_flag(FN, 0);
-    set_flag(FH, half_carry);
-    set_flag(FC, result > 0x00FF);  // Overflow
+    reg[A] = result;
 }
 
 void CPU::add16(uint8_t *dst, uint8_t *src)
@@ -592,10 +803,7 @@ void CPU::add16(uint8_t *dst, uint8_t *src)
     // Is the sum of upper byte only the same as result?
     bool half_carry = (((dst16 & 0xF000) + (src16 & 0xF000)) & 0xF000) != (result & 0xF000);
 
-    //set_flag(FZ, *(uint16_t*) dst == 0x0000);
-    set_flag(FN, 0);
-    set_flag(FH, half_carry);
-    set_flag(FC, result < dst16);
+    set_flags(get_zero(), 0, half_carry, result < dst16);
 }
 
 void CPU::addr8(uint8_t *dst, int value)
@@ -610,57 +818,48 @@ void CPU::addr8(uint8_t *dst, int value)
 
     result += value;
 
-    set_flag(FZ, 0);
-    set_flag(FN, 0);
-    set_flag(FH, (result & 0x0F) < (dst16 & 0x0F));
-    set_flag(FC, (result & 0xFF) < (dst16 & 0xFF));
+    set_flags(0, 0, (result & 0x0F) < (dst16 & 0x0F), (result & 0xFF) < (dst16 & 0xFF));
 
     *dst = (result & 0x0000FF00) >> 8;
     *(dst + 1) = result;
 }
 
-void CPU::push(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::push(uint8_t /*opcode*/)
 {
-    uint16_t value;
-    if (opcode == 0xC5) {
-        value = reg16(BC);
-    }
-    if (opcode == 0xD5) {
-        value = reg16(DE);
-    }
-    if (opcode == 0xE5) {
-        value = reg16(HL);
-    }
-    if (opcode == 0xF5) {
-        value = reg16(AF);
+    // BC, DE, HL then AF
+    constexpr size_t index = (opcode >> 4) - 0x0C;
+
+    uint8_t *high;
+    if constexpr (opcode == 0xF5) {
+        get_F();
+        high = &reg[AF];
+    } else {
+        high = get_target16<index>();
     }
 
-    uint8_t high = (uint8_t)((value & 0xFF00) >> 8);
-    uint8_t low = (uint8_t)(value & 0x00FF);
+    uint8_t *low = high + 1;
 
     dec16(&reg[SP]);
-    mmu->set(reg16(SP), high);
+    mmu->set(reg16(SP), *high);
     dec16(&reg[SP]);
-    mmu->set(reg16(SP), low);
+    mmu->set(reg16(SP), *low);
 
     PC += 1;
     clock += 16;
 }
 
-void CPU::pop(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::pop(uint8_t /*opcode*/)
 {
+    // BC, DE, HL then AF
+    constexpr size_t index = (opcode >> 4) - 0x0C;
+
     uint8_t *high;
-    if (opcode == 0xC1) {
-        high = &reg[BC];
-    }
-    if (opcode == 0xD1) {
-        high = &reg[DE];
-    }
-    if (opcode == 0xE1) {
-        high = &reg[HL];
-    }
-    if (opcode == 0xF1) {
+    if constexpr (opcode == 0xF1) {
         high = &reg[AF];
+    } else {
+        high = get_target16<index>();
     }
 
     uint8_t *low = high + 1;
@@ -674,36 +873,28 @@ void CPU::pop(uint8_t opcode)
     clock += 12;
 
     // 4 lower bits of flag register must remain at 0
-    if (opcode == 0xF1) {
-        reg[F] &= 0xF0;
+    if constexpr (opcode == 0xF1) {
+        set_F(reg[F]);
     }
 }
 
-void CPU::jp(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::jp(uint8_t /*opcode*/)
 {
-    uint8_t ticks = 16;
-    uint16_t address = mmu->get16(PC + 1);
-
     bool jump = true;
-    /* Jump if not Z */
-    if ((opcode == 0xC2 && get_bit(reg[F], FZ) == 1) ||
-    /* Jump if not C */
-        (opcode == 0xD2 && get_bit(reg[F], FC) == 1) ||
-    /* Jump if Z */
-        (opcode == 0xCA && get_bit(reg[F], FZ) == 0) ||
-    /* Jump if C */
-        (opcode == 0xDA && get_bit(reg[F], FC) == 0)) {
-        ticks = 12;
-        jump = false;
+
+    // Every JP a16 but the unconditional one
+    if constexpr (opcode != 0xC3) {
+        jump = check_condition<opcode>();
     }
 
     if (jump) {
-        PC = address;
+        PC = get_d16();
+        clock += 16;
     } else {
         PC += 3;
+        clock += 12;
     }
-
-    clock += ticks;
 }
 
 void CPU::jp_hl(uint8_t /*opcode*/)
@@ -712,57 +903,44 @@ void CPU::jp_hl(uint8_t /*opcode*/)
     clock += 4;
 }
 
-void CPU::call(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::call(uint8_t /*opcode*/)
 {
-    uint8_t ticks = 24;
-    uint16_t address = mmu->get16(PC + 1);
-
     PC += 3;
 
     bool do_call = true;
-    /* Call if not Z */
-    if ((opcode == 0xC4 && get_bit(reg[F], FZ) == 1) ||
-    /* Call if not C */
-        (opcode == 0xD4 && get_bit(reg[F], FC) == 1) ||
-    /* Call if Z */
-        (opcode == 0xCC && get_bit(reg[F], FZ) == 0) ||
-    /* Call if C */
-        (opcode == 0xDC && get_bit(reg[F], FC) == 0)) {
-        ticks = 12;
-        do_call = false;
+
+    // Every CALL a16 but the unconditional one
+    if constexpr (opcode != 0xCD) {
+        do_call = check_condition<opcode>();
     }
 
     if (do_call) {
-        _call(address);
+        _call(get_d16());
+        clock += 24;
+    } else {
+        clock += 12;
     }
-
-    clock += ticks;
 }
 
-void CPU::ret(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::ret(uint8_t /*opcode*/)
 {
     PC += 1;
 
-    /* RETI */
-    if (opcode == 0xD9) {
-        IME = true;
-        clock += 16;
-    }
+    /* RET and RETI */
+    if constexpr (opcode == 0xC9 || opcode == 0xD9) {
+        if constexpr (opcode == 0xD9) {
+            IME = true;
+        }
 
-    else if (opcode == 0xC9) {
         clock += 16;
-    }
-    /* Ret if not Z */
-    else if ((opcode == 0xC0 && get_bit(reg[F], FZ)) ||
-    /* Ret if not C */
-        (opcode == 0xD0 && get_bit(reg[F], FC)) ||
-    /* Ret if Z */
-        (opcode == 0xC8 && get_bit(reg[F], FZ) == 0) ||
-    /* Ret if C */
-        (opcode == 0xD8 && get_bit(reg[F], FC) == 0)) {
-        clock += 8;
-        return;
     } else {
+        if (!check_condition<opcode>()) {
+            clock += 8;
+            return;
+        }
+
         clock += 20;
     }
 
@@ -776,8 +954,7 @@ void CPU::cpl(uint8_t /*opcode*/)
 {
     reg[A] = ~reg[A];
 
-    set_flag(FN, 1);
-    set_flag(FH, 1);
+    set_flags(get_zero(), 1, 1, get_carry());
 
     PC += 1;
     clock += 4;
@@ -786,9 +963,7 @@ void CPU::cpl(uint8_t /*opcode*/)
 // Switch carry flag
 void CPU::ccf(uint8_t /*opcode*/)
 {
-    set_flag(FN, 0);
-    set_flag(FH, 0);
-    set_flag(FC, get_bit(reg[F], FC) == 0);
+    set_flags(get_zero(), 0, 0, !get_carry());
 
     PC += 1;
     clock += 4;
@@ -825,15 +1000,12 @@ void CPU::daa(uint8_t /*opcode*/)
     }
 
     // DO NOT RESET C even if this is false!
-    if (value & 0x100) {
-        set_flag(FC, true);
-    }
+    bool carry = get_flag(FC) || (value & 0x100);
 
     value &= 0xFF;
     reg[A] = value;
 
-    set_flag(FZ, value == 0);
-    set_flag(FH, 0);
+    set_flags(value == 0, get_flag(FN), 0, carry);
 
     PC += 1;
     clock += 4;
@@ -842,9 +1014,7 @@ void CPU::daa(uint8_t /*opcode*/)
 // Set carry flag
 void CPU::scf(uint8_t /*opcode*/)
 {
-    set_flag(FN, 0);
-    set_flag(FH, 0);
-    set_flag(FC, 1);
+    set_flags(get_zero(), 0, 0, 1);
 
     PC += 1;
     clock += 4;
@@ -883,94 +1053,77 @@ void CPU::halt(uint8_t /*opcode*/)
     clock += 4;
 }
 
-void CPU::add(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::add(uint8_t /*opcode*/)
 {
-    switch(opcode) {
-    case 0x09:
-    case 0x19:
-    case 0x29:
-    case 0x39:
+    /* ADD HL,r16 */
+    if constexpr (opcode < 0x40) {
         PC += 1;
         clock += 8;
-        return add16(&reg[HL], get_target16(opcode >> 4));
-    case 0xE8:
-        addr8(&reg[SP], mmu->get_signed(PC + 1));
+        return add16(&reg[HL], get_target16<(opcode >> 4)>());
+    }
+    /* ADD SP,r8 */
+    else if constexpr (opcode == 0xE8) {
+        addr8(&reg[SP], get_r8());
         PC += 2;
         clock += 16;
-        return;
-    default:
-        return add8(opcode);
+    } else {
+        return add8<opcode>();
     }
 }
 
-void CPU::inc(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::inc(uint8_t /*opcode*/)
 {
     PC += 1;
 
-    switch(opcode) {
     /* Inc 16-bit registers */
-    case 0x03:
-    case 0x13:
-    case 0x23:
-    case 0x33:
+    if constexpr ((opcode & 0x0F) == 0x03) {
         clock += 8;
-        return inc16(get_target16(opcode >> 4));
+        return inc16(get_target16<(opcode >> 4)>());
+    }
     /* Inc 8-bit registers */
-    case 0x34:
+    else if constexpr (opcode == 0x34) {
         clock += 12;     // INC (HL) takes 8 extra clock cycle (total 12)
         return inc8_mmu(reg16(HL));
-    case 0x04:
-    case 0x0C:
-    case 0x14:
-    case 0x1C:
-    case 0x24:
-    case 0x2C:
-    case 0x3C:
+    } else {
         clock += 4;
-        return inc8(get_target((opcode - 0x04) / 0x08));
+        return inc8(get_target<(opcode - 0x04) / 0x08>());
     }
 }
 
-void CPU::dec(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::dec(uint8_t /*opcode*/)
 {
     PC += 1;
 
-    switch(opcode) {
     /* Dec 16-bit registers */
-    case 0x0B:
-    case 0x1B:
-    case 0x2B:
-    case 0x3B:
+    if constexpr ((opcode & 0x0F) == 0x0B) {
         clock += 8;
-        return dec16(get_target16(opcode >> 4));
+        return dec16(get_target16<(opcode >> 4)>());
+    }
     /* Dec 8-bit registers */
-    case 0x35:
+    else if constexpr (opcode == 0x35) {
         clock += 12;
         return dec8_mmu(reg16(HL));
-    case 0x05:
-    case 0x0D:
-    case 0x15:
-    case 0x1D:
-    case 0x25:
-    case 0x2D:
-    case 0x3D:
+    } else {
         clock += 4;
-        return dec8(get_target((opcode - 0x05) / 0x08));
+        return dec8(get_target<(opcode - 0x05) / 0x08>());
     }
 }
 
-void CPU::jr(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::jr(uint8_t /*opcode*/)
 {
-    // Jump if flag Z is not set
-    if ((opcode == 0x20 && get_bit(reg[F], FZ) == 0) ||
-    // Jump if flag C is not set
-        (opcode == 0x30 && get_bit(reg[F], FC) == 0) ||
-    // Jump if flag Z is set
-        (opcode == 0x28 && get_bit(reg[F], FZ)) ||
-    // Jump if flag C is not set
-        (opcode == 0x38 && get_bit(reg[F], FC)) ||
-        (opcode == 0x18)) {
-        PC += mmu->get_signed(PC + 1);
+    bool jump = true;
+
+    // Every JR r8 but the unconditional one
+    if constexpr (opcode != 0x18) {
+        jump = check_condition<opcode>();
+    }
+
+    if (jump) {
+        PC += get_r8();
         clock += 4;
     }
 
@@ -978,190 +1131,148 @@ void CPU::jr(uint8_t opcode)
     clock += 8;
 }
 
-void CPU::ld(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::ld(uint8_t /*opcode*/)
 {
     /* Generic cases */
-    if (opcode >= 0x40 && opcode < 0x80) {
-        size_t dst_index = (opcode - 0x40) / 8;
-        size_t src_index = (opcode - 0x40) % 8;
+    if constexpr (opcode >= 0x40 && opcode < 0x80) {
+        constexpr size_t dst_index = (opcode - 0x40) / 8;
+        constexpr size_t src_index = (opcode - 0x40) % 8;
 
-        uint8_t *dst = get_target(dst_index);
-        uint8_t src = get_target_value(src_index);
+        constexpr size_t ticks = (dst_index == 6 || src_index == 6) ? 8 : 4;
 
-        size_t ticks = 4;
-        if (dst_index == 6 || src_index == 6) {
-            ticks += 4;
-        }
+        uint8_t src = get_target_value<src_index>();
 
         // LD (HL), ...
-        if (dst_index == 6) {
+        if constexpr (dst_index == 6) {
             return ld8_mmu(reg16(HL), src, 1, ticks);
+        } else {
+            return ld8(get_target<dst_index>(), src, 1, ticks);
         }
-
-        return ld8(dst, src, 1, ticks);
     }
 
-    uint16_t address;
-
-    /* Less generic cases */
-    switch (opcode) {
     /* Load 16-bit immediate to r16 */
-    case 0x01:    // Loads 16-bit immediate to BC
-    case 0x11:    // Loads 16-bit immediate to DE
-    case 0x21:    // Loads 16-bit immediate to HL
-    case 0x31:    // Loads 16-bit immediate to SP
-        ld16(get_target16(opcode >> 4), mmu->get(PC + 1), mmu->get(PC + 2), 3, 12);
-        break;
+    else if constexpr ((opcode & 0x0F) == 0x01) {
+        ld16(get_target16<(opcode >> 4)>(), get_d16(), get_d16() >> 8, 3, 12);
+    }
 
     /* Load reg A into pointed address */
-    case 0x02:    // Loads reg A to (BC)
+    else if constexpr (opcode == 0x02) {    // Loads reg A to (BC)
         ld8_mmu(reg16(BC), reg[A], 1, 8);
-        break;
+    }
 
-    case 0x12:    // Loads reg A to (DE)
+    else if constexpr (opcode == 0x12) {    // Loads reg A to (DE)
         ld8_mmu(reg16(DE), reg[A], 1, 8);
-        break;
+    }
 
-    case 0x22:    // Loads reg A to (HL), inc HL
+    else if constexpr (opcode == 0x22) {    // Loads reg A to (HL), inc HL
         ld8_mmu(reg16(HL), reg[A], 1, 8);
         inc16(&reg[HL]);
-        break;
+    }
 
-    case 0x32:    // Loads reg A to (HL), dec HL
+    else if constexpr (opcode == 0x32) {    // Loads reg A to (HL), dec HL
         ld8_mmu(reg16(HL), reg[A], 1, 8);
         dec16(&reg[HL]);
-        break;
+    }
 
     /* Load 16-bit Sp to (immediate 16-bit) */
-    case 0x08:
-        ld16_mmu(mmu->get16(PC + 1), reg16(SP), 3, 20);
-        break;
-
-    /* Load 8-bit immediate to reg */
-    case 0x06:    // Loads 8-bit immediate to B
-        ld8(&reg[B], mmu->get(PC + 1), 2, 8);
-        break;
-
-    case 0x16:    // Loads 8-bit immediate to D
-        ld8(&reg[D], mmu->get(PC + 1), 2, 8);
-        break;
+    else if constexpr (opcode == 0x08) {
+        ld16_mmu(get_d16(), reg16(SP), 3, 20);
+    }
 
-    case 0x26:    // Loads 8-bit immediate to H
-        ld8(&reg[H], mmu->get(PC + 1), 2, 8);
-        break;
+    /* Load 8-bit immediate to (HL) */
+    else if constexpr (opcode == 0x36) {
+        ld8_mmu(reg16(HL), get_d8(), 2, 12);
+    }
 
-    case 0x36:    // Loads 8-bit immediate to (HL)
-        ld8_mmu(reg16(HL), mmu->get(PC + 1), 2, 12);
-        break;
+    /* Load 8-bit immediate to reg (B, C, D, E, H, L, A) */
+    else if constexpr (opcode < 0x40 && (opcode & 0x07) == 0x06) {
+        ld8(get_target<(opcode >> 3)>(), get_d8(), 2, 8);
+    }
 
     /* Load pointed address into A */
-    case 0x0A:    // Loads (BC) to reg A
+    else if constexpr (opcode == 0x0A) {    // Loads (BC) to reg A
         ld8(&reg[A], mmu->get(reg16(BC)), 1, 8);
-        break;
+    }
 
-    case 0x1A:    // Loads (DE) to reg A
+    else if constexpr (opcode == 0x1A) {    // Loads (DE) to reg A
         ld8(&reg[A], mmu->get(reg16(DE)), 1, 8);
-        break;
+    }
 
-    case 0x2A:    // Loads (HL) to reg A, inc HL
+    else if constexpr (opcode == 0x2A) {    // Loads (HL) to reg A, inc HL
         ld8(&reg[A], mmu->get(reg16(HL)), 1, 8);
         inc16(&reg[HL]);
-        break;
+    }
 
-    case 0x3A:    // Loads (HL) to reg A, dec HL
+    else if constexpr (opcode == 0x3A) {    // Loads (HL) to reg A, dec HL
         ld8(&reg[A], mmu->get(reg16(HL)), 1, 8);
         dec16(&reg[HL]);
-        break;
-
-    /* Load 8-bit immediate to reg */
-    case 0x0E:    // Loads 8-bit immediate to C
-        ld8(&reg[C], mmu->get(PC + 1), 2, 8);
-        break;
-
-    case 0x1E:    // Loads 8-bit immediate to E
-        ld8(&reg[E], mmu->get(PC + 1), 2, 8);
-        break;
-
-    case 0x2E:    // Loads 8-bit immediate to L
-        ld8(&reg[L], mmu->get(PC + 1), 2, 8);
-        break;
-
-    case 0x3E:    // Loads 8-bit immediate to A
-        ld8(&reg[A], mmu->get(PC + 1), 2, 8);
-        break;
+    }
 
     /* Loads from/to 8-bit address */
-    case 0xE0:      // Loads reg A to address immediate
-        address = 0xFF00 + mmu->get(PC + 1);
-        ld8_mmu(address, reg[A], 2, 12);
-        break;
+    else if constexpr (opcode == 0xE0) {    // Loads reg A to address immediate
+        ld8_mmu(0xFF00 + get_d8(), reg[A], 2, 12);
+    }
 
-    case 0xF0:      // Loads from address immediate to reg A
-        address = 0xFF00 + mmu->get(PC + 1);
-        ld8(&reg[A], mmu->get(address), 2, 12);
-        break;
+    else if constexpr (opcode == 0xF0) {    // Loads from address immediate to reg A
+        ld8(&reg[A], mmu->get(0xFF00 + get_d8()), 2, 12);
+    }
 
-    case 0xE2:      // Loads from addres reg C to reg A
+    else if constexpr (opcode == 0xE2) {    // Loads from addres reg C to reg A
         ld8_mmu(0xFF00 + reg[C], reg[A], 1, 8);
-        break;
+    }
 
-    case 0xF2:      // Loads from reg A to addres reg C
+    else if constexpr (opcode == 0xF2) {    // Loads from reg A to addres reg C
         ld8(&reg[A], mmu->get(0xFF00 + reg[C]), 1, 8);
-        break;
+    }
 
     /* Loads from/to 16-bit address */
-    case 0xEA:      // Loads reg A to address immediate
-        ld8_mmu(mmu->get16(PC + 1), reg[A], 3, 16);
-        break;
+    else if constexpr (opcode == 0xEA) {    // Loads reg A to address immediate
+        ld8_mmu(get_d16(), reg[A], 3, 16);
+    }
 
-    case 0xFA:      // LD A,(a16)
-        ld8(&reg[A], mmu->get(mmu->get16(PC + 1)), 3, 16);
-        break;
+    else if constexpr (opcode == 0xFA) {    // LD A,(a16)
+        ld8(&reg[A], mmu->get(get_d16()), 3, 16);
+    }
 
-    case 0xF8:      // LD HL,SP+r8
+    else if constexpr (opcode == 0xF8) {    // LD HL,SP+r8
         memcpy(&reg[HL], &reg[SP], sizeof(uint16_t));
-        addr8(&reg[HL], mmu->get_signed(PC + 1));
+        addr8(&reg[HL], get_r8());
 
         PC += 2;
         clock += 12;
-        break;
+    }
 
-    case 0xF9:      // Loads HL content to SP
+    else if constexpr (opcode == 0xF9) {    // Loads HL content to SP
         memcpy(&reg[SP], &reg[HL], sizeof(uint16_t));
 
         PC += 1;
         clock += 8;
-        break;
     }
 }
 
-void CPU::rxa(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::rxa(uint8_t /*opcode*/)
 {
-    bool is_left = true;
-    if (opcode == 0x0F || opcode == 0x1F) {
-        is_left = false;
-    }
+    constexpr bool is_left = (opcode != 0x0F && opcode != 0x1F);
 
-    bool carry, old_carry = get_bit(reg[F], FC);
+    bool carry, old_carry = get_carry();
     reg[A] = rotate(reg[A], is_left, &carry);
 
     bool new_value = carry;
 
     /* Through carry flag */
-    if (opcode == 0x17 || opcode == 0x1F) {
+    if constexpr (opcode == 0x17 || opcode == 0x1F) {
         new_value = old_carry;
     }
 
-    if (is_left) {
+    if constexpr (is_left) {
         reg[A] = set_bit(reg[A], 0, new_value);
     } else {
         reg[A] = set_bit(reg[A], 7, new_value);
     }
 
-    set_flag(FZ, 0);
-    set_flag(FN, 0);
-    set_flag(FH, 0);
-    set_flag(FC, carry);
+    set_flags(0, 0, 0, carry);
 
     PC += 1;
     clock += 4;
@@ -1173,53 +1284,54 @@ void CPU::nop(uint8_t /*opcode*/)
     clock += 4;
 }
 
-void CPU::prefix_CB(uint8_t opcode)
+void CPU::prefix_CB(uint8_t /*opcode*/)
+{
+    uint8_t opcode = get_d8();
+
+    (*this.*l_callback_CB[opcode])(opcode);
+}
+
+template <uint8_t opcode>
+void CPU::CB(uint8_t /*opcode*/)
 {
     // Get BIT opcode on (HL) have unique ticks and source register is not modified afterwards
-    bool is_getbit_hl = false;
+    constexpr size_t index = opcode % 8;
+    constexpr bool is_getbit = (opcode >= 0x40 && opcode < 0x80);
 
-    opcode = mmu->get(PC + 1);
-    size_t index = opcode % 8;
-    uint8_t value = get_target_value(index);
+    uint8_t value = get_target_value<index>();
 
-    size_t offset = (opcode / 8) % 8;
-    bool is_left = (opcode % 16) < 8;
-    bool carry, old_carry = get_bit(reg[F], FC);
+    constexpr size_t offset = (opcode / 8) % 8;
+    constexpr bool is_left = (opcode % 16) < 8;
+    bool carry, old_carry = get_carry();
 
     /* Rotate */
-    if (opcode < 0x20) {
+    if constexpr (opcode < 0x20) {
         value = rotate(value, is_left, &carry);
 
         /* Opcode to 0x10 set new byte to the shifted one */
         bool new_value = carry;
 
         /* Through carry flag */
-        if (opcode >= 0x10) {
+        if constexpr (opcode >= 0x10) {
             new_value = old_carry;
         }
 
-        if (is_left) {
+        if constexpr (is_left) {
             value = set_bit(value, 0, new_value);
         } else {
             value = set_bit(value, 7, new_value);
         }
 
-        set_flag(FZ, value == 0);
-        set_flag(FN, 0);
-        set_flag(FH, 0);
-        set_flag(FC, carry);
+        set_flags(value == 0, 0, 0, carry);
     }
     /* Shitf Left (SLA) */
-    else if (opcode < 0x28) {
+    else if constexpr (opcode < 0x28) {
         value = shift(value, UTIL_LEFT, &carry);
 
-        set_flag(FZ, value == 0);
-        set_flag(FN, 0);
-        set_flag(FH, 0);
-        set_flag(FC, carry);
+        set_flags(value == 0, 0, 0, carry);
     }
     /* Shitf Right, keep b7 (SRA) */
-    else if (opcode < 0x30) {
+    else if constexpr (opcode < 0x30) {
         bool b0 = get_bit(value, 0);
         bool b7 = get_bit(value, 7);
 
@@ -1227,182 +1339,139 @@ void CPU::prefix_CB(uint8_t opcode)
 
         value = set_bit(value, 7, b7);
 
-        set_flag(FZ, value == 0);
-        set_flag(FN, 0);
-        set_flag(FH, 0);
-        set_flag(FC, b0);
+        set_flags(value == 0, 0, 0, b0);
     }
     /* Swap */
-    else if (opcode < 0x38) {
+    else if constexpr (opcode < 0x38) {
         value = swap(value);
 
-        set_flag(FZ, value == 0);
-        set_flag(FN, 0);
-        set_flag(FH, 0);
-        set_flag(FC, 0);
+        set_flags(value == 0, 0, 0, 0);
     }
     /* Shitf Right Logical (SRL) */
-    else if (opcode < 0x40) {
+    else if constexpr (opcode < 0x40) {
         value = shift(value, UTIL_RIGHT, &carry);
 
-        set_flag(FZ, value == 0);
-        set_flag(FN, 0);
-        set_flag(FH, 0);
-        set_flag(FC, carry);
+        set_flags(value == 0, 0, 0, carry);
     }
     /* Get Bit */
-    else if (opcode < 0x80) {
-        set_flag(FZ, get_bit(value, offset) == 0);
-        set_flag(FN, 0);
-        set_flag(FH, 1);
-
-        // Except for 0x46, 0x56, 0x66, 0x76 and 0x4E, 0x5E, 0x6E, 0x7E (HL)
-        if ((opcode & 0x0F) == 0x06 || (opcode & 0x0F) == 0x0E) {
-            is_getbit_hl = true;
-        }
+    else if constexpr (is_getbit) {
+        set_flags(get_bit(value, offset) == 0, 0, 1, get_carry());
     }
     /* Set and Reset */
     else {
         value = set_bit(value, offset, opcode >= 0xC0);
     }
 
-    size_t ticks = 8;
-    /* Addressing (HL) takes 8 additional cycles */
-    if (opcode % 8 == 6) {
-        if (is_getbit_hl) {
-            ticks = 12;
-        } else {
-            ticks = 16;
-        }
-    }
-
     PC += 2;
-    clock += ticks;
 
-    // (HL) case
-    if (index == 6) {
-        if (!is_getbit_hl) {
+    // (HL) case, addressing takes 8 additional cycles (4 for BIT)
+    if constexpr (index == 6) {
+        if constexpr (is_getbit) {
+            clock += 12;
+        } else {
+            clock += 16;
             mmu->set(reg16(HL), value);
         }
     } else {
-        uint8_t *register_address = get_target(index);
-        *register_address = value;
+        clock += 8;
+
+        if constexpr (!is_getbit) {
+            *get_target<index>() = value;
+        }
     }
 }
 
-void CPU::or_xor_and_cp(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::or_xor_and_cp(uint8_t /*opcode*/)
 {
-    size_t target_index = opcode % 8;
-    uint8_t target = get_target_value(target_index);
+    uint8_t target;
 
     // OR/XOR/AND/CP with d8
-    if (opcode > 0xC0) {
-        target = mmu->get(PC + 1);
+    if constexpr (opcode > 0xC0) {
+        target = get_d8();
         PC += 2;
         clock += 8;
     }
     // (HL) case
-    else if (target_index == 6) {
+    else if constexpr (opcode % 8 == 6) {
+        target = get_target_value<6>();
         PC += 1;
         clock += 8;
     }
     else {
+        target = get_target_value<opcode % 8>();
         PC += 1;
         clock += 4;
     }
 
     // CP
-    if ((opcode >= 0xB8 && opcode < 0xC0) || opcode == 0xFE) {
-        // We add an extra 0x0100 so we can detect underflow if high byte is 0x00
-        // after the comparison
-        uint16_t result = 0x0100 + reg[A];
-        result -= target;
-
-        set_flag(FZ, (result & 0x00FF) == 0);
-        set_flag(FN, 1);
-        set_flag(FH, (reg[A] & 0x0F) < (target & 0x0F));
-        set_flag(FC, !(result & 0x100));   // Underflow
+    if constexpr ((opcode >= 0xB8 && opcode < 0xC0) || opcode == 0xFE) {
+        defer_flags(LAZY_FLAGS_SUB, reg[A], target, reg[A] - target, false);
     }
     // OR
-    else if ((opcode >= 0xB0 && opcode < 0xB8) || opcode == 0xF6) {
+    else if constexpr ((opcode >= 0xB0 && opcode < 0xB8) || opcode == 0xF6) {
         reg[A] |= target;
 
-        set_flag(FZ, reg[A] == 0);
-        set_flag(FN, 0);
-        set_flag(FH, 0);
-        set_flag(FC, 0);
+        defer_flags(LAZY_FLAGS_OR, 0, 0, reg[A], false);
     }
     // XOR
-    else if ((opcode >= 0xA8 && opcode < 0xB0) || opcode == 0xEE) {
+    else if constexpr ((opcode >= 0xA8 && opcode < 0xB0) || opcode == 0xEE) {
         reg[A] ^= target;
 
-        set_flag(FZ, reg[A] == 0);
-        set_flag(FN, 0);
-        set_flag(FH, 0);
-        set_flag(FC, 0);
+        defer_flags(LAZY_FLAGS_OR, 0, 0, reg[A], false);
     }
     // AND
-    else if ((opcode >= 0xA0 && opcode < 0xA8) || opcode == 0xE6) {
+    else {
         reg[A] &= target;
 
-        set_flag(FZ, reg[A] == 0);
-        set_flag(FN, 0);
-        set_flag(FH, 1);
-        set_flag(FC, 0);
+        defer_flags(LAZY_FLAGS_AND, 0, 0, reg[A], false);
     }
 }
 
 /**
  * @brief      Handles SUB and SBC
  */
-void CPU::sub(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::sub(uint8_t /*opcode*/)
 {
-    size_t target_index = opcode % 8;
-    uint8_t target = get_target_value(target_index);
+    uint8_t target;
 
     // SUB/SBC d8
-    if (opcode > 0xD0) {
-        target = mmu->get(PC + 1);
+    if constexpr (opcode > 0xD0) {
+        target = get_d8();
         PC += 2;
         clock += 8;
     }
     // (HL) case
-    else if (target_index == 6) {
+    else if constexpr (opcode % 8 == 6) {
+        target = get_target_value<6>();
         PC += 1;
         clock += 8;
     } else {
+        target = get_target_value<opcode % 8>();
         PC += 1;
         clock += 4;
     }
 
-    uint16_t value = target;
-
-    bool half_carry = (reg[A] & 0x0F) < (value & 0x0F);
-
-    uint16_t result = (0x0100 + reg[A]) - value;
+    bool carry = false;
 
     // SBC
-    if (opcode >= 0x98 && opcode != 0xD6) {
-        value = get_bit(reg[F], FC);
-
-        // FH set when substracting carry flag
-        half_carry |= (result & 0x0F) < (value & 0x0F);
-
-        result -= value;
+    if constexpr (opcode >= 0x98 && opcode != 0xD6) {
+        carry = get_carry();
     }
 
-    reg[A] = (uint8_t) result;
+    uint8_t result = reg[A] - target - carry;
+
+    defer_flags(LAZY_FLAGS_SUB, reg[A], target, result, carry);
 
-    set_flag(FZ, reg[A] == 0);
-    set_flag(FN, 1);
-    set_flag(FH, half_carry);
-    set_flag(FC, !(result & 0x100));   // Underflow
+    reg[A] = result;
 }
 
-void CPU::ei_di(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::ei_di(uint8_t /*opcode*/)
 {
     // EI
-    if (opcode == 0xFB) {
+    if constexpr (opcode == 0xFB) {
         ei_requested = true;
         ei_delay = 1;
     } else {
@@ -1414,7 +1483,8 @@ void CPU::ei_di(uint8_t opcode)
     clock += 4;
 }
 
-void CPU::rst(uint8_t opcode)
+template <uint8_t opcode>
+void CPU::rst(uint8_t /*opcode*/)
 {
     PC += 1;
 
@@ -1435,7 +1505,6 @@ void CPU::rst(uint8_t opcode)
     clock += 16;
 }
 
-
 /**
  * @brief      Call that does not affect clock
  * @param[in]  address  The address
@@ -1509,6 +1578,115 @@ void CPU::adjust_clocks(size_t adjustment)
 }
 
 
+/**
+ * @brief      Skips time the CPU would spend idle before the next event
+ *
+ * Only events (PPU, timer, APU) change interrupt flags or the LCD registers,
+ * so until the deadline a halted CPU stays halted and a polling loop keeps
+ * reading the same value. The clock ends where stepping would have left it.
+ * @param[in]  deadline  Clock of the next event
+ */
+void CPU::fast_forward(size_t deadline)
+{
+    if (clock > deadline || ei_requested || halt_bug) {
+        return;
+    }
+
+    // Polling loops all end with a JR cc back to their start
+    bool polling = !halted && (instruction->opcode & 0xE7) == 0x20 && get_d8() == 0xFA;
+    if (!halted && !polling) {
+        return;
+    }
+
+    uint8_t pending = mmu->get(IF_ADDRESS) & mmu->get(IE_ADDRESS) & 0x1F;
+    if (pending) {
+        return;
+    }
+
+    if (halted) {
+        // Halted steps take 4 cycles until the first one after deadline
+        clock += ((deadline - clock) / 4 + 1) * 4;
+        return;
+    }
+
+    skip_polling_loop(deadline);
+}
+
+
+/**
+ * @brief      Skips iterations of a loop waiting for LY or LCD mode
+ *
+ * Recognized loops are 6 bytes long and look like:
+ *      LDH A,(LY)      or LDH A,(STAT)
+ *      CP d8           or AND d8
+ *      JR cc,-6
+ * @param[in]  deadline  Clock of the next event
+ * @return     true if some iterations were skipped
+ */
+bool CPU::skip_polling_loop(size_t deadline)
+{
+    const size_t loop_ticks = 12 + 8 + 12;
+
+    const uint8_t *code = mmu->get_code(PC);
+    if (code == nullptr || (PC & (MMU_PAGE_SIZE - 1)) + 6 > MMU_PAGE_SIZE) {
+        return false;
+    }
+
+    uint16_t io_address = 0xFF00 + code[1];
+    if (code[0] != 0xF0 || (io_address != LY && io_address != LCD_STATUS)) {
+        return false;
+    }
+
+    if ((code[2] != 0xFE && code[2] != 0xE6) || (code[4] & 0xE7) != 0x20 || code[5] != 0xFA) {
+        return false;
+    }
+
+    uint8_t value = mmu->get(io_address);
+    uint8_t operand = code[3];
+
+    // Each iteration leaves A and F the same way
+    uint8_t a;
+    bool z, n, h, c;
+
+    // CP d8
+    if (code[2] == 0xFE) {
+        a = value;
+        z = (value == operand);
+        n = true;
+        h = (value & 0x0F) < (operand & 0x0F);
+        c = value < operand;
+    }
+    // AND d8
+    else {
+        a = value & operand;
+        z = (a == 0);
+        n = false;
+        h = true;
+        c = false;
+    }
+
+    // NZ, Z, NC, C
+    bool flag = (code[4] & 0x10) ? c : z;
+    bool expected = code[4] & 0x08;
+
+    // Loop would exit this time
+    if (flag != expected) {
+        return false;
+    }
+
+    size_t iterations = (deadline - clock) / loop_ticks;
+    if (iterations == 0) {
+        return false;
+    }
+
+    reg[A] = a;
+    set_flags(z, n, h, c);
+    clock += iterations * loop_ticks;
+
+    return true;
+}
+
+
 void CPU::set_mmu(MMU *mmu)
 {
     this->mmu = mmu;
@@ -1528,6 +1706,7 @@ void CPU::serialize(std::ofstream &file)
 
     file.write(reinterpret_cast<char*>(&PC), sizeof(uint16_t));
 
+    get_F();
     file.write(reinterpret_cast<char*>(reg), sizeof(uint8_t) * REGISTER_COUNT);
 }
 
@@ -1546,4 +1725,5 @@ void CPU::deserialize(std::ifstream &file)
     file.read(reinterpret_cast<char*>(&PC), sizeof(uint16_t));
 
     file.read(reinterpret_cast<char*>(reg), sizeof(uint8_t) * REGISTER_COUNT);
+    set_F(reg[F]);
 }
@@ -5,10 +5,10 @@
 #include <cstddef>
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 #include "defines.h"
 #include "mmu.h"
-#include "gui/debugger.h"
 
 // 8-Bits registers
 #define A               0   //<! Accumulator
@@ -27,9 +27,28 @@
 #define HL              H
 #define SP              8   //<! Stack Pointer
 
+// Last ALU operation, its flags are computed only when F is read
+#define LAZY_FLAGS_NONE     0   //<! reg[F] is up to date
+#define LAZY_FLAGS_ADD      1   //<! ADD/ADC
+#define LAZY_FLAGS_SUB      2   //<! SUB/SBC/CP
+#define LAZY_FLAGS_AND      3
+#define LAZY_FLAGS_OR       4   //<! OR/XOR
+#define LAZY_FLAGS_INC      5
+#define LAZY_FLAGS_DEC      6
+
 class CPU;
 typedef void (CPU::*cpu_callback)(uint8_t opcode);
 
+/**
+ * @brief      Instruction with its operands already read
+ */
+struct cpu_instruction {
+    const uint8_t *source;  //<! ROM byte decoded, nullptr if not cached
+    cpu_callback callback;
+    uint8_t opcode;
+    uint16_t operand;       //<! Immediate value, 8-bit ones in low byte
+};
+
 /**
  * @brief      Central Processing Unit
  */
@@ -46,10 +65,53 @@ private:
     size_t ei_delay;    // How many step before acknowledging ei request
 
     cpu_callback l_callback[MAX_OPCODES];
+    cpu_callback l_callback_CB[MAX_OPCODES];
+
+    template <uint8_t opcode> void set_callbacks_CB();
+
+    // ROM instructions are decoded once, keyed by address and bank
+    std::vector<cpu_instruction> code_cache;
+    size_t code_version;
+
+    cpu_instruction decoded;                // Instruction out of cache
+    const cpu_instruction *instruction;     // Instruction being executed
 
-    uint8_t *get_target(size_t index);
-    uint8_t get_target_value(size_t index);
-    uint8_t *get_target16(size_t index);
+    const cpu_instruction *fetch();
+    void decode(uint16_t address, uint8_t opcode, cpu_instruction *result);
+    void flush_code_cache();
+
+    uint8_t get_d8() { return instruction->operand; };
+    int8_t get_r8() { return instruction->operand; };
+    uint16_t get_d16() { return instruction->operand; };
+
+    // Operands of the last ALU operation, see LAZY_FLAGS_*
+    uint8_t lazy_op;
+    uint8_t lazy_a;
+    uint8_t lazy_b;
+    uint8_t lazy_result;
+    bool lazy_carry;        //<! Carry in for ADD/SUB, C kept by INC/DEC
+
+    // Flags are set all at once, 4 lower bits remain at 0
+    void set_flags(bool z, bool n, bool h, bool c) {
+        reg[F] = (z << FZ) | (n << FN) | (h << FH) | (c << FC);
+        lazy_op = LAZY_FLAGS_NONE;
+    };
+
+    void defer_flags(uint8_t op, uint8_t a, uint8_t b, uint8_t result, bool carry) {
+        lazy_op = op;
+        lazy_a = a;
+        lazy_b = b;
+        lazy_result = result;
+        lazy_carry = carry;
+    };
+
+    bool get_zero();
+    bool get_carry();
+
+    template <size_t index> uint8_t *get_target();
+    template <size_t index> uint8_t get_target_value();
+    template <size_t index> uint8_t *get_target16();
+    template <uint8_t opcode> bool check_condition();
 
 
     void ld8(uint8_t *dst, uint8_t src, size_t size, size_t ticks);
@@ -62,46 +124,49 @@ private:
     void dec8(uint8_t *address);
     void dec8_mmu(uint16_t address);
 
-    void add8(uint8_t opcode);
+    template <uint8_t opcode> void add8();
     void add16(uint8_t *dst, uint8_t *src);
     void addr8(uint8_t *dst, int value);
 
+    // Opcodes handlers, templates are instantiated once per opcode
     void prefix_CB(uint8_t opcode);
-    void CB_set(uint8_t opcode);
+    template <uint8_t opcode> void CB(uint8_t);
 
-    void push(uint8_t opcode);
-    void pop(uint8_t opcode);
-    void call(uint8_t opcode);
-    void ret(uint8_t opcode);
+    template <uint8_t opcode> void push(uint8_t);
+    template <uint8_t opcode> void pop(uint8_t);
+    template <uint8_t opcode> void call(uint8_t);
+    template <uint8_t opcode> void ret(uint8_t);
     void cpl(uint8_t opcode);
     void ccf(uint8_t opcode);
     void daa(uint8_t opcode);
     void scf(uint8_t opcode);
     void stop(uint8_t opcode);
     void halt(uint8_t opcode);
-    void add(uint8_t opcode);
-    void inc(uint8_t opcode);
-    void dec(uint8_t opcode);
-    void jr(uint8_t opcode);
-    void ld(uint8_t opcode);
-    void rxa(uint8_t opcode);
+    template <uint8_t opcode> void add(uint8_t);
+    template <uint8_t opcode> void inc(uint8_t);
+    template <uint8_t opcode> void dec(uint8_t);
+    template <uint8_t opcode> void jr(uint8_t);
+    template <uint8_t opcode> void ld(uint8_t);
+    template <uint8_t opcode> void rxa(uint8_t);
     void nop(uint8_t opcode);
-    void or_xor_and_cp(uint8_t opcode);
-    void sub(uint8_t opcode);
-    void jp(uint8_t opcode);
+    template <uint8_t opcode> void or_xor_and_cp(uint8_t);
+    template <uint8_t opcode> void sub(uint8_t);
+    template <uint8_t opcode> void jp(uint8_t);
     void jp_hl(uint8_t opcode);
-    void ei_di(uint8_t opcode);
-    void rst(uint8_t opcode);
+    template <uint8_t opcode> void ei_di(uint8_t);
+    template <uint8_t opcode> void rst(uint8_t);
 
     void _call(uint16_t address);
     bool handle_interrupts();
 
+    bool skip_polling_loop(size_t deadline);
+
     friend class Debugger;
 
 public:
     size_t clock;
 
-    // TODO: Force F flag to be always 0-3 at 0
+    // F is only up to date once get_F() has been called
     uint8_t reg[REGISTER_COUNT];
     uint16_t PC;                    //<! Program Counter
 
@@ -114,9 +179,13 @@ public:
     void set_flag(size_t flag, bool value);
     bool get_flag(size_t flag);
 
+    uint8_t get_F();
+    void set_F(uint8_t value);
+
     uint16_t reg16(size_t i);
 
     void adjust_clocks(size_t adjustment);
+    void fast_forward(size_t deadline);
 
     void set_mmu(MMU *mmu);
 
@@ -6,16 +6,19 @@
 // Emulation settings
 #define FPS                 30
 #define GLSL_VERSION        "#version 130"
-#define FRAME_CYCLES        70244       //<! Amount of CPU cycle between each frame
+#define FRAME_CYCLES        70224       //<! Amount of CPU cycle between each frame (154 lines of 456)
 #define DEFAULT_SPEED       10          // Speed of the emulator
 #define SAVE_SLOT_COUNT     5           // Amount of possible save states
 
 #define DMG_MAX_CLOCK_VALUE     100000000000   // Maximum value of clocks before adjusting
 #define DMG_CLOCK_ADJUSTMENT    80000000000    // What we substract to adjust clocks
 
+#define SCHEDULER_CAPACITY      8       // Maximum amount of pending events
+
 // CPU constants
 #define MAX_OPCODES         256
 #define REGISTER_COUNT      10  //<! 8x8-bit for standard registers + 2x8-bit for SP (16-bit)
+#define CODE_CACHE_SIZE     0x8000  //<! One decoded instruction per ROM0/ROM1 address
 
 // Flags
 #define FZ               7  //<! Zero Flag
@@ -26,17 +29,31 @@
 // Sound
 #define SOUND_FREQUENCY             48000   // Output freqeuncy (for downsample period)
 #define SOUND_CHANNEL_COUNT         2
-#define SOUND_SAMPLE_SIZE           SOUND_CHANNEL_COUNT * sizeof(int16_t)
+#define SOUND_SAMPLE_SIZE           (SOUND_CHANNEL_COUNT * sizeof(int16_t))
 
 #define SOUND_FRAME_SEQ_CLOCK_STEP  8192    // Runs a 8192 CPU clock
 #define SOUND_FRAME_SEQ_STEP_COUNT  8       // Frame sequencer count of steps
 #define SOUND_VOLUME_ENVELOPE_FREQ  64      // Volume Envelope triggers every 64 frame seq
 #define SOUND_FREQ_SWEEP_FREQ       128     // Frequency Sweep triggers every 128 frame seq
 
+#define SOUND_CLOCK_RATE            4194304 // CPU clocks per second
+#define SOUND_DAC_STEP              128     // Amplitude of one DAC input step
+
+// Band-limited synthesis
+#define BLIP_BUFFER_SIZE            4096    // Samples, far more than between two APU steps
+#define BLIP_FRAC_BITS              32      // Fixed point sample positions
+#define BLIP_PHASE_BITS             6       // Sub-sample positions of the kernel
+#define BLIP_PHASE_COUNT            (1 << BLIP_PHASE_BITS)
+#define BLIP_KERNEL_WIDTH           16      // Samples affected by a delta
+#define BLIP_KERNEL_BITS            15      // Kernel fixed point, its taps sum to 1 << 15
+#define BLIP_CUTOFF                 0.45    // Low-pass frequency, fraction of the sample rate
+#define BLIP_BASS_SHIFT             9       // High-pass, removes the DAC DC offset
+
 // Downsampler
-#define SOUND_DOWNSAMPLE_CLOCK_STEP     87
 #define SOUND_DOWNSAMPLE_SAMPLES        512
-#define SOUND_DOWNSAMPLE_BUFFER_SIZE    SOUND_DOWNSAMPLE_SAMPLES * SOUND_CHANNEL_COUNT
+#define SOUND_DOWNSAMPLE_BUFFER_SIZE    (SOUND_DOWNSAMPLE_SAMPLES * SOUND_CHANNEL_COUNT)
+#define SOUND_LEVEL_BITS                3       // NR50 levels are eighths
+#define SOUND_GENERATOR_COUNT           4       // Pulse A, Pulse B, Wave and Noise
 
 // Duty
 #define SOUND_PULSE_A_DUTY_SIZE     8       // Each duty is 8 steps
@@ -97,9 +114,15 @@
 #define CRASH_END           0xFEFF
 #define IO_START            0xFF00
 #define IO_END              0xFF7F
+#define IO_SIZE             0x80
 #define HRAM_START          0xFF80
 #define HRAM_END            0xFFFF
 
+// Memory map is split in pages of 256 bytes
+#define MMU_PAGE_SHIFT      8
+#define MMU_PAGE_SIZE       0x100
+#define MMU_PAGE_COUNT      0x100
+
 #define WAVE_START          0xFF30
 #define WAVE_END            0xFF3F
 #define FF_START            0xFF27
@@ -111,6 +134,7 @@
 #define MAP_ADDRESS_2       0x9C00
 
 #define SPRITE_TILE_ADDRESS TILE_ADDRESS_1
+#define TILE_DATA_END       0x97FF
 
 // Registers addresses
 #define JOYPAD              0xFF00      // Joypad
@@ -198,8 +222,12 @@
 #define MASK_MODE                           0b00000011
 
 #define PALETTE_SIZE            4       // How many colors available
+#define SHADE_LCD_DISABLED      PALETTE_SIZE    // Extra shade while the LCD is off
+#define SHADE_COUNT             (PALETTE_SIZE + 1)
 #define SPRITE_PALETTE_COUNT    2       // OBP0 and OBP1
 
+#define RENDER_NEVER            0       // Render interval to never draw anything
+
 #define V_BLANK_PERIOD      10
 #define MAX_LY              LINE_Y_COUNT + V_BLANK_PERIOD
 
@@ -223,16 +251,30 @@
 #define TILE_LINE_SIZE          2       // Size of a line of a tile in bytes
 
 // Size of a tile in memory in bytes. Should be 0x10
-#define TILE_SIZE               TILE_HEIGHT * TILE_LINE_SIZE
+#define TILE_SIZE               (TILE_HEIGHT * TILE_LINE_SIZE)
 
 // Size of the FIFO for the PPU
 #define FIFO_SIZE               16
 
+// How many tiles in VRAM tile data ($8000 - $97FF)
+#define TILE_COUNT              384
+
 // Cartridge
 #define CART_TYPE_ROM_ONLY              0x00
 #define CART_TYPE_MBC1                  0x01
 #define CART_TYPE_MBC1_RAM              0x02
 #define CART_TYPE_MBC1_RAM_BATTERY      0x03
+#define CART_TYPE_MBC3_TIMER_BATTERY    0x0F
+#define CART_TYPE_MBC3_TIMER_RAM_BATTERY 0x10
+#define CART_TYPE_MBC3                  0x11
+#define CART_TYPE_MBC3_RAM              0x12
+#define CART_TYPE_MBC3_RAM_BATTERY      0x13
+#define CART_TYPE_MBC5                  0x19
+#define CART_TYPE_MBC5_RAM              0x1A
+#define CART_TYPE_MBC5_RAM_BATTERY      0x1B
+#define CART_TYPE_MBC5_RUMBLE           0x1C
+#define CART_TYPE_MBC5_RUMBLE_RAM       0x1D
+#define CART_TYPE_MBC5_RUMBLE_RAM_BATTERY 0x1E
 
 // Inputs
 #define SELECT_BUTTON_KEY_MASKS       0b00100000
@@ -247,6 +289,7 @@
 #define INPUT_CLOCK         0b00000011
 
 #define DIV_FREQUENCY       256
+#define TIMER_RESOLUTION    16          // Counting (re)starts on a multiple of it
 
 
 enum address_type {
@@ -265,6 +308,26 @@ enum address_type {
 };
 
 
+// Ordered by priority when two events fire on the same clock
+enum event_type {
+    EVENT_PPU,
+    EVENT_TIMER,
+    EVENT_APU
+};
+
+
+enum joypad_button {
+    BUTTON_A,
+    BUTTON_B,
+    BUTTON_START,
+    BUTTON_SELECT,
+    BUTTON_UP,
+    BUTTON_DOWN,
+    BUTTON_LEFT,
+    BUTTON_RIGHT
+};
+
+
 enum pixel_type {
     BG,
     WINDOW,
@@ -273,6 +336,12 @@ enum pixel_type {
 };
 
 
+enum ppu_renderer {
+    RENDERER_SCANLINE,  // Whole line at once from decoded tiles
+    RENDERER_FIFO       // Pixel by pixel through the FIFO, more accurate
+};
+
+
 enum ppu_mode {
     H_BLANK = 0,
     V_BLANK,
@@ -1,20 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include <SDL2/SDL.h>
 #include <fstream>
-#include "imgui.h"
-#include "imgui_impl_sdl.h"
-#include "imgui_impl_opengl3.h"
 
 #include "log.h"
 
 #include "dmg.h"
 
 
+DMG::DMG() :
+    mmu(nullptr), cpu(nullptr), ppu(nullptr), input(nullptr), timer(nullptr),
+    apu(nullptr), scheduler(nullptr), watcher(nullptr), palette(0)
+{
+
+}
+
+
 DMG::~DMG()
 {
-    delete debugger;
+    delete scheduler;
     delete apu;
     delete input;
     delete timer;
@@ -22,15 +26,13 @@ DMG::~DMG()
     delete cpu;
     delete mmu;
 
-    debugger = nullptr;
+    scheduler = nullptr;
     apu = nullptr;
     input = nullptr;
     timer = nullptr;
     ppu = nullptr;
     cpu = nullptr;
     mmu = nullptr;
-
-    SDL_Quit();
 }
 
 
@@ -46,120 +48,131 @@ bool DMG::init(const char *bios_path, const char *rom_path)
         this->rom_path = rom_path;
     }
 
-    // Setup SDL
-    if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
-        error("Unable to initialize SDL\n");
-        return false;
-    }
-
     mmu = new MMU();
     cpu = new CPU();
     ppu = new PPU();
     timer = new Timer();
     input = new Input();
     apu = new APU();
-    debugger = new Debugger();
+    scheduler = new Scheduler();
 
+    mmu->set_dmg(this);
     mmu->set_ppu(ppu);
     mmu->set_timer(timer);
     mmu->set_input(input);
     mmu->set_apu(apu);
-    mmu->set_debugger(debugger);
     cpu->set_mmu(mmu);
     ppu->set_mmu(mmu);
     timer->set_mmu(mmu);
+    timer->set_dmg(this);
     input->set_mmu(mmu);
     apu->set_mmu(mmu);
     apu->set_dmg(this);
-    debugger->set_cpu(cpu);
-    debugger->set_mmu(mmu);
-    debugger->set_ppu(ppu);
-    debugger->set_apu(apu);
-    debugger->set_dmg(this);
-
-    running  = true;
-    running &= mmu->init(this->bios_path, this->rom_path);
-    running &= cpu->init();
-    running &= ppu->init();
-    running &= timer->init();
-    running &= input->init();
-    running &= apu->init();
-    running &= debugger->init();
+
+    bool success = true;
+    success &= mmu->init(this->bios_path, this->rom_path);
+    success &= cpu->init();
+    success &= ppu->init();
+    success &= timer->init();
+    success &= input->init();
+    success &= apu->init();
 
     set_palette(palette);
-    set_speed(DEFAULT_SPEED);
 
     save_slot = 0;
     dmg_clock = 0;
     system_clock = 0;
-    last_tick = 0;
     current_clock = 0;
 
     reset();
 
-    return running;
+    return success;
 }
 
 
 /**
- * @brief      Main loop
- * @return     return code for the application
+ * @brief      Runs the CPU until the next scheduled event then process it
  */
-int DMG::run()
+void DMG::process()
 {
-    while (running) {
-        Uint32 current_tick = SDL_GetTicks();
-        dmg_clock += 4195 * (current_tick - last_tick); //  4194304 / 1000
-        last_tick = current_tick;
-
-        for (size_t i=0; i<debugger->get_speed(); i++) {
-            if (!debugger->update() && system_clock < dmg_clock) {
-                process();
+    update_system_clock();
+
+    // CPU goes first when it shares its clock with an event
+    while (cpu->clock <= scheduler->get_next_deadline()) {
+        current_clock = cpu->clock;
+        bool instruction_done = cpu->step();
+        current_clock = cpu->clock;
+
+        if (watcher != nullptr) {
+            if (instruction_done) {
+                watcher->step_dmg = false;
             }
-        }
 
-        debugger->draw();
+            // Breakpoint reached or single step done
+            if (watcher->is_suspended()) {
+                return;
+            }
+        }
 
-        handle_events();
+        // HALT and polling loops have nothing to do until next event
+        cpu->fast_forward(scheduler->get_next_deadline());
+        current_clock = cpu->clock;
     }
 
-    return EXIT_SUCCESS;
+    dispatch_event();
 }
 
 
 /**
- * @brief      Dispatch process time to each DMG component
+ * @brief      Steps the sub-system owning the earliest event and re-schedule it
  */
-void DMG::process()
+void DMG::dispatch_event()
 {
-    update_system_clock();
-
-    input->update();
-
-    if (system_clock >= cpu->clock) {
-        current_clock = cpu->clock;
-        if (cpu->step()) {
-            debugger->step_dmg = false;
-        }
-        current_clock = cpu->clock;
-    }
-
-    if (system_clock >= ppu->clock) {
+    switch (scheduler->pop()) {
+    case EVENT_PPU:
         current_clock = ppu->clock;
         ppu->step();
         current_clock = ppu->clock;
-    }
-
-    if (system_clock >= timer->clock) {
+        scheduler->post(EVENT_PPU, ppu->clock);
+        break;
+    // Only fires on TIMA overflows, the timer posts the next one itself
+    case EVENT_TIMER:
         current_clock = timer->clock;
         timer->step();
-        current_clock = timer->clock;
-    }
-
-    if (system_clock >= apu->clock) {
+        break;
+    case EVENT_APU:
         current_clock = apu->clock;
         apu->step();
         current_clock = apu->clock;
+        scheduler->post(EVENT_APU, apu->clock);
+        break;
+    }
+}
+
+
+/**
+ * @brief      (Re)schedule every sub-system from their own clock
+ */
+void DMG::schedule_all()
+{
+    scheduler->reset();
+    scheduler->post(EVENT_PPU, ppu->clock);
+    schedule(EVENT_TIMER, timer->clock);
+    scheduler->post(EVENT_APU, apu->clock);
+}
+
+
+/**
+ * @brief      Moves the event of a sub-system, which can change outside of it
+ * @param[in]  type      The event
+ * @param[in]  deadline  Its new clock, SIZE_MAX when not expected anymore
+ */
+void DMG::schedule(event_type type, size_t deadline)
+{
+    if (deadline == SIZE_MAX) {
+        scheduler->cancel(type);
+    } else {
+        scheduler->post(type, deadline);
     }
 }
 
@@ -172,23 +185,25 @@ void DMG::update_system_clock()
     if (system_clock > DMG_MAX_CLOCK_VALUE) {
         info("adjust clocks\n");
         timer->adjust_clocks(DMG_CLOCK_ADJUSTMENT);
+        mmu->adjust_clocks(DMG_CLOCK_ADJUSTMENT);
         ppu->adjust_clocks(DMG_CLOCK_ADJUSTMENT);
         cpu->adjust_clocks(DMG_CLOCK_ADJUSTMENT);
         apu->adjust_clocks(DMG_CLOCK_ADJUSTMENT);
+        scheduler->adjust_clocks(DMG_CLOCK_ADJUSTMENT);
 
         dmg_clock -= DMG_CLOCK_ADJUSTMENT;
     }
 
-    system_clock = apu->clock;
-    if (ppu->clock < system_clock) {
-        system_clock = ppu->clock;
-    }
+    system_clock = scheduler->get_next_deadline();
     if (cpu->clock < system_clock) {
         system_clock = cpu->clock;
     }
-    if (timer->clock < system_clock) {
-        system_clock = timer->clock;
-    }
+}
+
+
+size_t DMG::get_system_clock()
+{
+    return system_clock;
 }
 
 
@@ -199,56 +214,58 @@ size_t DMG::get_current_clock()
 
 
 /**
- * @brief      Dispatch events to all subsystems
+ * @brief      Emulates one frame worth of cycles as fast as possible
  */
-void DMG::handle_events()
+void DMG::run_frame()
 {
-    SDL_Event event;
+    run_cycles(FRAME_CYCLES);
+}
 
-    while (SDL_PollEvent(&event)) {
-        debugger->handle_event(&event);
 
-        if (event.window.windowID == ppu->get_window_id()) {
-            input->handle(&event);
-        }
+/**
+ * @brief      Emulates the given amount of cycles as fast as possible
+ *
+ * Returns once every sub-system reached the target. Any overshoot is taken
+ * from the next call so consecutive calls do not drift.
+ * @param[in]  cycles  How many cycles to run
+ */
+void DMG::run_cycles(size_t cycles)
+{
+    dmg_clock += cycles;
 
-        switch(event.type) {
-        case SDL_QUIT:
-            running = false;
-            break;
-        case SDL_WINDOWEVENT:
-            switch(event.window.event) {
-            case SDL_WINDOWEVENT_CLOSE:
-                Uint32 window_id = event.window.windowID;
-
-                if (window_id == debugger->get_window_id()) {
-                    debugger->hide();
-                }
-
-                if (window_id == ppu->get_window_id()) {
-                    running = false;
-                }
-                break;
-            }
-            break;
-        case SDL_KEYDOWN:
-            switch(event.key.keysym.sym){
-            case SDLK_F3:   // Save state
-                save_state();
-                break;
-            case SDLK_F4:   // Next slot
-                select_next_save_slot();
-                break;
-            case SDLK_F5:   // Load state
-                load_state();
-                break;
-            }
-            break;
+    update_system_clock();
+    while (system_clock < dmg_clock) {
+        // Breakpoint reached or single step done
+        if (watcher != nullptr && watcher->is_suspended()) {
+            return;
         }
+
+        process();
+        update_system_clock();
     }
 }
 
 
+/**
+ * @brief      Lets real time go by, the system clock has to catch up with it
+ * @param[in]  ms    Time elapsed in milliseconds
+ */
+void DMG::elapse(size_t ms)
+{
+    dmg_clock += 4195 * ms; //  4194304 / 1000
+}
+
+
+/**
+ * @brief      Indicates if emulation is behind real time
+ * @return     true if the DMG should process some more
+ */
+bool DMG::is_late()
+{
+    return system_clock < dmg_clock;
+}
+
+
 void DMG::reset()
 {
     mmu->reset();
@@ -258,6 +275,8 @@ void DMG::reset()
     input->reset();
     apu->reset();
 
+    schedule_all();
+
     // No boot rom, skip to game start
     if (mmu->no_boot) {
         cpu->PC = 0x0100;
@@ -278,9 +297,84 @@ void DMG::set_palette(size_t palette_index)
 }
 
 
-void DMG::set_speed(size_t speed)
+/**
+ * @brief      Select how the PPU draws lines
+ * @param[in]  renderer  RENDERER_SCANLINE (fast) or RENDERER_FIFO (accurate)
+ */
+void DMG::set_renderer(ppu_renderer renderer)
+{
+    ppu->set_renderer(renderer);
+}
+
+
+/**
+ * @brief      Skip drawing frames, emulation is not affected
+ * @param[in]  interval  Draw one frame every interval frames, RENDER_NEVER for none
+ */
+void DMG::set_render_interval(size_t interval)
 {
-    debugger->set_speed(speed);
+    ppu->set_render_interval(interval);
+}
+
+
+/**
+ * @brief      Sound can be turned off when nobody listens, emulation is not affected
+ * @param[in]  enabled  Whether samples are produced
+ */
+void DMG::set_audio_synthesis(bool enabled)
+{
+    apu->set_synthesis(enabled);
+}
+
+
+void DMG::set_button(joypad_button button, bool pressed)
+{
+    input->set_button(button, pressed);
+}
+
+
+void DMG::set_video_sink(VideoSink *video)
+{
+    ppu->set_video_sink(video);
+}
+
+
+/**
+ * @brief      Gets the screen as shades, no video sink needed
+ * @return     SCREEN_WIDTH * SCREEN_HEIGHT shades, see PPU::get_framebuffer
+ */
+const uint8_t *DMG::get_framebuffer()
+{
+    return ppu->get_framebuffer();
+}
+
+
+/**
+ * @brief      Reads memory the way the CPU does
+ * @param[in]  address  The address
+ * @return     The value
+ */
+uint8_t DMG::get(uint16_t address)
+{
+    return mmu->get(address);
+}
+
+
+void DMG::set_audio_sink(AudioSink *audio)
+{
+    apu->set_audio_sink(audio);
+}
+
+
+/**
+ * @brief      Attach something following the execution (debugger)
+ * @param      watcher  The watcher, nullptr to detach
+ */
+void DMG::set_watcher(Watcher *watcher)
+{
+    this->watcher = watcher;
+
+    mmu->set_watcher(watcher);
 }
 
 
@@ -375,6 +469,8 @@ void DMG::load_state()
 
     file.close();
 
+    schedule_all();
+
     // Set DMG clock
     update_system_clock();
     dmg_clock = system_clock;
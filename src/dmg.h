@@ -8,11 +8,15 @@
 #include "input.h"
 #include "timer.h"
 #include "apu.h"
-#include "gui/debugger.h"
+#include "scheduler.h"
+#include "sink.h"
+#include "watcher.h"
 
 
 /**
  * @brief      DMG Emulator
+ *
+ * Headless: displays, speakers and debugger are plugged in by the front-end.
  */
 class DMG {
     MMU *mmu;
@@ -21,17 +25,16 @@ class DMG {
     Input *input;
     Timer *timer;
     APU *apu;
+    Scheduler *scheduler;
 
-    Debugger *debugger;
+    Watcher *watcher;
 
-    bool running;
     bool no_boot;
 
     size_t system_clock;        // Emulator clock: Smallest clock amongst sub-systems
     // Clock based on real time elapsed, system clock should catch up with this
     size_t dmg_clock;
     size_t current_clock;   // Clock of the system last processed
-    Uint32 last_tick;       // Used to compute dmg_clock
 
     std::string bios_path;
     std::string rom_path;
@@ -41,20 +44,38 @@ class DMG {
 public:
     size_t save_slot;
 
+    DMG();
     ~DMG();
 
     bool init(const char *bios_path, const char *rom_path);
-    int run();
     void process();
-    void handle_events();
     void reset();
 
+    void run_frame();
+    void run_cycles(size_t cycles);
+
+    void elapse(size_t ms);
+    bool is_late();
+
     void update_system_clock();
+    size_t get_system_clock();
     size_t get_current_clock();
+    void schedule_all();
+    void schedule(event_type type, size_t deadline);
+    void dispatch_event();
 
     void fake_boot();
     void set_palette(size_t palette_index);
-    void set_speed(size_t speed);
+    void set_renderer(ppu_renderer renderer);
+    void set_render_interval(size_t interval);
+    void set_audio_synthesis(bool enabled);
+    void set_button(joypad_button button, bool pressed);
+
+    void set_video_sink(VideoSink *video);
+    const uint8_t *get_framebuffer();
+    uint8_t get(uint16_t address);
+    void set_audio_sink(AudioSink *audio);
+    void set_watcher(Watcher *watcher);
 
     void load_rom(std::string filepath);
 
@@ -17,11 +17,30 @@
 static MemoryEditor memoryViewer;
 
 
+/**
+ * @brief      Given an array of data, give a texture ID
+ * @param      data data to use for pixels array of [3] for RGB
+ * @return     ImGui texture ID
+ */
+static GLuint create_texture(uint8_t data[], size_t width, size_t height)
+{
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    return textureID;
+}
+
+
 Debugger::Debugger() : cpu(nullptr), mmu(nullptr), dmg(nullptr), ppu(nullptr)
 {
     running = false;
-    suspend_dmg = false;
-    step_dmg = false;
 
     sdl_window = nullptr;
 
@@ -39,7 +58,6 @@ Debugger::Debugger() : cpu(nullptr), mmu(nullptr), dmg(nullptr), ppu(nullptr)
     show_apu = false;
     show_breakpoints = false;
 
-    breakpoint_activated = false;
     breakpoints.clear();
 }
 
@@ -147,22 +165,24 @@ bool Debugger::init()
  */
 bool Debugger::update()
 {
-    dmg->set_speed(execution_speed);
-
-    return suspend_dmg && !step_dmg;
+    return is_suspended();
 }
 
 
-void Debugger::draw()
+/**
+ * @brief      Builds the debugger windows from the emulator state
+ *
+ * Reads and changes the DMG: the emulation must not run meanwhile.
+ * @return     true if a frame was built and should be rendered
+ */
+bool Debugger::draw()
 {
     // Display
     Uint32 current_ticks = SDL_GetTicks();
     if (current_ticks < last_refresh + (1000 / FPS)) {
-        return;
+        return false;
     }
 
-    ImGuiIO& io = ImGui::GetIO();
-
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL2_NewFrame(sdl_window);
     ImGui::NewFrame();
@@ -199,16 +219,29 @@ void Debugger::draw()
 
     display_load_game();
 
-    // Rendering
     ImGui::Render();
+
+    last_refresh = current_ticks;
+
+    return true;
+}
+
+
+/**
+ * @brief      Renders the frame built by draw(), waits for vsync
+ *
+ * Only uses ImGui draw data: the emulation may run meanwhile.
+ */
+void Debugger::render()
+{
+    ImGuiIO& io = ImGui::GetIO();
+
     SDL_GL_MakeCurrent(sdl_window, gl_context);
     glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
     glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
     glClear(GL_COLOR_BUFFER_BIT);
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     SDL_GL_SwapWindow(sdl_window);
-
-    last_refresh = current_ticks;
 }
 
 
@@ -308,7 +341,7 @@ void Debugger::display_registers()
 
         ImGui::Text("PC: 0x%04X", cpu->PC);
         ImGui::Separator();
-        ImGui::Text("A: 0x%02X F: 0x%02X", cpu->reg[A], cpu->reg[F]);
+        ImGui::Text("A: 0x%02X F: 0x%02X", cpu->reg[A], cpu->get_F());
         ImGui::Text("B: 0x%02X C: 0x%02X", cpu->reg[B], cpu->reg[C]);
         ImGui::Text("D: 0x%02X E: 0x%02X", cpu->reg[D], cpu->reg[E]);
         ImGui::Text("H: 0x%02X L: 0x%02X", cpu->reg[H], cpu->reg[L]);
@@ -1146,9 +1179,18 @@ void Debugger::set_mmu(MMU *mmu)
 }
 
 
+/**
+ * @brief      Links the DMG along with the sub-systems it runs
+ * @param      dmg   The dmg
+ */
 void Debugger::set_dmg(DMG *dmg)
 {
     this->dmg = dmg;
+
+    set_cpu(dmg->cpu);
+    set_mmu(dmg->mmu);
+    set_ppu(dmg->ppu);
+    set_apu(dmg->apu);
 }
 
 
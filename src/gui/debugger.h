@@ -8,6 +8,7 @@
 #include "imfilebrowser.h"
 
 #include "../defines.h"
+#include "../watcher.h"
 
 #define DEBUGGER_SAVE           ".breakpoints"
 
@@ -50,7 +51,7 @@ class APU;
 /**
  * @brief      Displays emulator informations/status
  */
-class Debugger {
+class Debugger : public Watcher {
 public:
     // Which window to display
     bool show_execution;
@@ -63,10 +64,6 @@ public:
 
     bool show_demo; // DEBUG
 
-    bool suspend_dmg;
-    bool step_dmg;
-
-    bool breakpoint_activated;
     std::vector<Breakpoint> breakpoints;
 
 
@@ -75,7 +72,8 @@ public:
 
     bool init();
     bool update();
-    void draw();
+    bool draw();
+    void render();
     void handle_event(SDL_Event *event);
     void show();
     void hide();
@@ -0,0 +1,254 @@
+#include "frontend.h"
+
+#include "../log.h"
+
+
+Frontend::Frontend() :
+    dmg(nullptr), debugger(nullptr), video(nullptr), audio(nullptr),
+    emulation_thread(nullptr)
+{
+    running = false;
+    last_tick = 0;
+}
+
+
+Frontend::~Frontend()
+{
+    delete debugger;
+    delete dmg;
+    delete audio;
+    delete video;
+
+    debugger = nullptr;
+    dmg = nullptr;
+    audio = nullptr;
+    video = nullptr;
+
+    SDL_Quit();
+}
+
+
+bool Frontend::init(const char *bios_path, const char *rom_path)
+{
+    // Setup SDL
+    if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
+        error("Unable to initialize SDL\n");
+        return false;
+    }
+
+    dmg = new DMG();
+    video = new SDLVideo();
+    audio = new SDLAudio();
+    debugger = new Debugger();
+
+    bool success = true;
+    success &= dmg->init(bios_path, rom_path);
+    success &= video->init();
+    success &= audio->init();
+
+    debugger->set_dmg(dmg);
+    success &= debugger->init();
+
+    dmg->set_video_sink(video);
+    dmg->set_audio_sink(audio);
+    dmg->set_watcher(debugger);
+
+    set_speed(DEFAULT_SPEED);
+
+    running = success;
+
+    return success;
+}
+
+
+/**
+ * @brief      Main loop: events and windows, paced by vsync
+ * @return     return code for the application
+ */
+int Frontend::run()
+{
+    emulation_thread = SDL_CreateThread(&Frontend::emulate, "Emulation", this);
+    if (emulation_thread == nullptr) {
+        error("Unable to start the emulation thread: %s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    while (running) {
+        bool debugger_drawn;
+        {
+            std::lock_guard<std::mutex> guard(dmg_lock);
+            handle_events();
+            debugger_drawn = debugger->draw();
+        }
+
+        // Both wait for vsync, without holding the DMG
+        if (debugger_drawn) {
+            debugger->render();
+        }
+        video->refresh();
+    }
+
+    SDL_WaitThread(emulation_thread, nullptr);
+    emulation_thread = nullptr;
+
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * @brief      Emulation thread: keeps the DMG up with real time
+ * @param      data  The front-end
+ * @return     0
+ */
+int Frontend::emulate(void *data)
+{
+    Frontend *frontend = static_cast<Frontend *>(data);
+
+    while (frontend->running) {
+        bool late;
+        {
+            std::lock_guard<std::mutex> guard(frontend->dmg_lock);
+
+            Uint32 current_tick = SDL_GetTicks();
+            frontend->dmg->elapse(current_tick - frontend->last_tick);
+            frontend->last_tick = current_tick;
+
+            for (size_t i=0; i<frontend->debugger->get_speed(); i++) {
+                if (!frontend->debugger->update() && frontend->dmg->is_late()) {
+                    frontend->dmg->process();
+                }
+            }
+
+            late = frontend->dmg->is_late() && !frontend->debugger->update();
+        }
+
+        // Caught up or suspended: let the main thread have the DMG
+        if (!late) {
+            SDL_Delay(1);
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief      Dispatch events to the DMG and the debugger
+ */
+void Frontend::handle_events()
+{
+    SDL_Event event;
+
+    while (SDL_PollEvent(&event)) {
+        debugger->handle_event(&event);
+
+        if (event.window.windowID == video->get_window_id()) {
+            handle_key(&event);
+        }
+
+        switch(event.type) {
+        case SDL_QUIT:
+            running = false;
+            break;
+        case SDL_WINDOWEVENT:
+            switch(event.window.event) {
+            case SDL_WINDOWEVENT_CLOSE:
+                Uint32 window_id = event.window.windowID;
+
+                if (window_id == debugger->get_window_id()) {
+                    debugger->hide();
+                }
+
+                if (window_id == video->get_window_id()) {
+                    running = false;
+                }
+                break;
+            }
+            break;
+        case SDL_KEYDOWN:
+            switch(event.key.keysym.sym){
+            case SDLK_F3:   // Save state
+                dmg->save_state();
+                break;
+            case SDLK_F4:   // Next slot
+                dmg->select_next_save_slot();
+                break;
+            case SDLK_F5:   // Load state
+                dmg->load_state();
+                break;
+            }
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief      Translate keyboard keys into joypad buttons
+ * @param      event  The event
+ */
+void Frontend::handle_key(SDL_Event *event)
+{
+    if (event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) {
+        return;
+    }
+
+    bool pressed = event->type == SDL_KEYDOWN;
+
+    switch(event->key.keysym.sym) {
+    case SDLK_LEFT:     dmg->set_button(BUTTON_LEFT, pressed);      break;
+    case SDLK_RIGHT:    dmg->set_button(BUTTON_RIGHT, pressed);     break;
+    case SDLK_UP:       dmg->set_button(BUTTON_UP, pressed);        break;
+    case SDLK_DOWN:     dmg->set_button(BUTTON_DOWN, pressed);      break;
+    case SDLK_a:        dmg->set_button(BUTTON_A, pressed);         break;
+    case SDLK_z:        dmg->set_button(BUTTON_B, pressed);         break;
+    case SDLK_SPACE:    dmg->set_button(BUTTON_START, pressed);     break;
+    case SDLK_RETURN:   dmg->set_button(BUTTON_SELECT, pressed);    break;
+    }
+}
+
+
+/**
+ * @brief      Change color palette to use
+ * @param[in]  palette_index  0 default green
+ *                            1 black/white
+ */
+void Frontend::set_palette(size_t palette_index)
+{
+    dmg->set_palette(palette_index);
+}
+
+
+void Frontend::set_renderer(ppu_renderer renderer)
+{
+    dmg->set_renderer(renderer);
+}
+
+
+void Frontend::set_render_interval(size_t interval)
+{
+    dmg->set_render_interval(interval);
+}
+
+
+void Frontend::set_audio_latency(size_t latency)
+{
+    audio->set_latency(latency);
+}
+
+
+/**
+ * @brief      Closes the audio device, the sound is not even generated
+ */
+void Frontend::disable_audio()
+{
+    dmg->set_audio_sink(nullptr);
+    dmg->set_audio_synthesis(false);
+    audio->quit();
+}
+
+
+void Frontend::set_speed(size_t speed)
+{
+    debugger->set_speed(speed);
+}
@@ -0,0 +1,53 @@
+#ifndef FRONTEND_H
+#define FRONTEND_H
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "../dmg.h"
+#include "debugger.h"
+#include "sdl_video.h"
+#include "sdl_audio.h"
+
+
+/**
+ * @brief      SDL front-end: window, sound, inputs and debugger around a DMG
+ *
+ * The DMG runs on its own thread so it never waits on the window system. SDL
+ * windows, events and the debugger stay on the main thread, which takes
+ * dmg_lock whenever it reads or changes the emulator.
+ */
+class Frontend {
+    DMG *dmg;
+    Debugger *debugger;
+    SDLVideo *video;
+    SDLAudio *audio;
+
+    std::atomic<bool> running;
+    Uint32 last_tick;       // Used to let the DMG know how much time passed
+
+    SDL_Thread *emulation_thread;
+    std::mutex dmg_lock;    // Held by the thread touching the DMG
+
+    static int emulate(void *data);
+    void handle_key(SDL_Event *event);
+
+public:
+    Frontend();
+    ~Frontend();
+
+    bool init(const char *bios_path, const char *rom_path);
+    int run();
+    void handle_events();
+
+    void set_palette(size_t palette_index);
+    void set_renderer(ppu_renderer renderer);
+    void set_render_interval(size_t interval);
+    void set_audio_latency(size_t latency);
+    void disable_audio();
+    void set_speed(size_t speed);
+};
+
+#endif /* FRONTEND_H */
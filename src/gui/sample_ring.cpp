@@ -0,0 +1,84 @@
+#include "sample_ring.h"
+
+#include "../defines.h"
+
+
+/**
+ * @param[in]  capacity  How many frames can be stored, must be a power of two
+ */
+SampleRing::SampleRing(size_t capacity) :
+    samples(capacity * SOUND_CHANNEL_COUNT), capacity(capacity),
+    write_position(0), read_position(0)
+{
+
+}
+
+
+/**
+ * @brief      Producer: adds frames, the ones not fitting are dropped
+ * @param[in]  frames  Interleaved stereo frames
+ * @param[in]  count   How many frames
+ * @return     How many frames were added
+ */
+size_t SampleRing::push(const int16_t *frames, size_t count)
+{
+    size_t write = write_position.load(std::memory_order_relaxed);
+    size_t read = read_position.load(std::memory_order_acquire);
+
+    size_t space = capacity - (write - read);
+    if (count > space) {
+        count = space;
+    }
+
+    for (size_t i=0; i<count; i++) {
+        size_t index = ((write + i) & (capacity - 1)) * SOUND_CHANNEL_COUNT;
+
+        samples[index] = frames[i * SOUND_CHANNEL_COUNT];
+        samples[index + 1] = frames[i * SOUND_CHANNEL_COUNT + 1];
+    }
+
+    write_position.store(write + count, std::memory_order_release);
+
+    return count;
+}
+
+
+/**
+ * @brief      Consumer: how many frames can be read
+ */
+size_t SampleRing::size()
+{
+    return write_position.load(std::memory_order_acquire) -
+        read_position.load(std::memory_order_relaxed);
+}
+
+
+size_t SampleRing::get_capacity()
+{
+    return capacity;
+}
+
+
+/**
+ * @brief      Consumer: reads a frame without consuming it
+ * @param[in]  offset  From the oldest frame, lower than size()
+ * @return     Left then right samples
+ */
+const int16_t *SampleRing::get_frame(size_t offset)
+{
+    size_t read = read_position.load(std::memory_order_relaxed);
+
+    return samples.data() + ((read + offset) & (capacity - 1)) * SOUND_CHANNEL_COUNT;
+}
+
+
+/**
+ * @brief      Consumer: releases the oldest frames to the producer
+ * @param[in]  count  How many frames, at most size()
+ */
+void SampleRing::consume(size_t count)
+{
+    size_t read = read_position.load(std::memory_order_relaxed);
+
+    read_position.store(read + count, std::memory_order_release);
+}
@@ -0,0 +1,36 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <vector>
+
+
+/**
+ * @brief      Lock-free ring of stereo frames, one producer and one consumer
+ *
+ * The producer only moves the write position and the consumer only moves
+ * the read position: neither ever waits for the other.
+ */
+class SampleRing {
+    std::vector<int16_t> samples;   // Interleaved left/right
+    size_t capacity;                // In frames, power of two
+
+    // Frames written/read since the start, wrap with capacity
+    std::atomic<size_t> write_position;
+    std::atomic<size_t> read_position;
+
+public:
+    SampleRing(size_t capacity);
+
+    size_t push(const int16_t *frames, size_t count);
+    size_t size();
+    size_t get_capacity();
+
+    const int16_t *get_frame(size_t offset);
+    void consume(size_t count);
+};
+
+#endif /* SAMPLE_RING_H */
@@ -0,0 +1,138 @@
+#include "sdl_audio.h"
+
+#include "../defines.h"
+#include "../log.h"
+
+
+SDLAudio::SDLAudio() :
+    audio_device(0), ring(AUDIO_RING_FRAMES), position(0), last_frame{0, 0}
+{
+    set_latency(AUDIO_LATENCY);
+}
+
+
+SDLAudio::~SDLAudio()
+{
+    quit();
+}
+
+
+/**
+ * @brief      Opens the audio device
+ * @return     true success
+ */
+bool SDLAudio::init()
+{
+    SDL_AudioSpec audio_spec;
+    SDL_zero(audio_spec);
+    audio_spec.freq = SOUND_FREQUENCY;
+    audio_spec.format = AUDIO_S16SYS;
+    audio_spec.channels = SOUND_CHANNEL_COUNT;
+    audio_spec.samples = SOUND_DOWNSAMPLE_SAMPLES;
+    audio_spec.callback = &SDLAudio::callback;
+    audio_spec.userdata = this;
+
+    audio_device = SDL_OpenAudioDevice(NULL, 0, &audio_spec, NULL, 0);
+    if (audio_device <= 0) {
+        error("Erreur d'ouverture audio: %s\n", SDL_GetError());
+        return false;
+    }
+
+    SDL_PauseAudioDevice(audio_device, 0);
+
+    return true;
+}
+
+
+void SDLAudio::quit()
+{
+    if (audio_device > 0) {
+        SDL_CloseAudioDevice(audio_device);
+    }
+
+    audio_device = 0;
+}
+
+
+/**
+ * @brief      Queue samples to be played, never waits
+ * Samples not fitting in the ring are dropped
+ * @param[in]  samples  Interleaved stereo samples
+ * @param[in]  count    How many int16_t in samples
+ */
+void SDLAudio::queue(const int16_t *samples, size_t count)
+{
+    ring.push(samples, count / SOUND_CHANNEL_COUNT);
+}
+
+
+void SDLAudio::callback(void *data, Uint8 *stream, int length)
+{
+    static_cast<SDLAudio *>(data)->fill(
+        reinterpret_cast<int16_t *>(stream), length / SOUND_SAMPLE_SIZE);
+}
+
+
+/**
+ * @brief      Audio thread: plays queued samples with dynamic rate control
+ * A bit faster above the target latency, slower below. Linear interpolation
+ * between the frames of the ring.
+ * @param      stream  Interleaved stereo samples to fill
+ * @param[in]  count   How many frames
+ */
+void SDLAudio::fill(int16_t *stream, size_t count)
+{
+    size_t available = ring.size();
+
+    double ratio = 1.0 + AUDIO_RATE_CONTROL *
+        ((double)available - (double)target_frames) / (double)target_frames;
+
+    if (ratio < 1.0 - AUDIO_RATE_CONTROL) {
+        ratio = 1.0 - AUDIO_RATE_CONTROL;
+    } else if (ratio > 1.0 + AUDIO_RATE_CONTROL) {
+        ratio = 1.0 + AUDIO_RATE_CONTROL;
+    }
+
+    for (size_t i=0; i<count; i++) {
+        size_t index = (size_t)position;
+
+        // Underrun: hold the last value rather than clicking
+        if (index + 1 < available) {
+            const int16_t *current = ring.get_frame(index);
+            const int16_t *next = ring.get_frame(index + 1);
+            double weight = position - index;
+
+            for (size_t channel=0; channel<SOUND_CHANNEL_COUNT; channel++) {
+                last_frame[channel] = current[channel] + (next[channel] - current[channel]) * weight;
+            }
+
+            position += ratio;
+        }
+
+        stream[i * SOUND_CHANNEL_COUNT] = last_frame[0];
+        stream[i * SOUND_CHANNEL_COUNT + 1] = last_frame[1];
+    }
+
+    size_t played = (size_t)position;
+    ring.consume(played);
+    position -= played;
+}
+
+
+/**
+ * @brief      Set how much sound is kept queued
+ * @param[in]  latency  In ms
+ */
+void SDLAudio::set_latency(size_t latency)
+{
+    target_frames = SOUND_FREQUENCY * latency / 1000;
+
+    // Leave room for the rate control to catch up
+    if (target_frames > ring.get_capacity() / 2) {
+        target_frames = ring.get_capacity() / 2;
+    }
+
+    if (target_frames == 0) {
+        target_frames = 1;
+    }
+}
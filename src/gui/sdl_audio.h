@@ -0,0 +1,44 @@
+#ifndef SDL_AUDIO_H
+#define SDL_AUDIO_H
+
+#include <SDL2/SDL.h>
+
+#include "../sink.h"
+#include "sample_ring.h"
+
+#define AUDIO_RING_FRAMES       8192    // Frames that can be queued (~170 ms), power of two
+#define AUDIO_LATENCY           40      // Default ms of sound kept queued
+#define AUDIO_RATE_CONTROL      0.005   // Max playback speed adjustment
+
+
+/**
+ * @brief      Plays the APU output on the default SDL audio device
+ *
+ * Samples go through a lock-free ring drained by the SDL audio callback.
+ * The playback speed is slightly adjusted to keep the ring around the
+ * target latency instead of blocking the emulation.
+ */
+class SDLAudio : public AudioSink {
+    SDL_AudioDeviceID audio_device;
+
+    SampleRing ring;
+    size_t target_frames;           // Frames queued aimed at
+    double position;                // Position in the ring of the next frame to play
+    int16_t last_frame[2];          // Played again on underrun
+
+    static void callback(void *data, Uint8 *stream, int length);
+
+public:
+    SDLAudio();
+    ~SDLAudio();
+
+    bool init();
+    void quit();
+
+    void queue(const int16_t *samples, size_t count);
+    void fill(int16_t *stream, size_t count);
+
+    void set_latency(size_t latency);
+};
+
+#endif /* SDL_AUDIO_H */
@@ -0,0 +1,144 @@
+#include "sdl_video.h"
+
+#include <string.h>
+
+#include "../log.h"
+
+
+SDLVideo::SDLVideo() :
+    sdl_window(nullptr), sdl_renderer(nullptr), sdl_texture(nullptr),
+    back_frame(0), ready_frame(1), front_frame(2)
+{
+
+}
+
+
+SDLVideo::~SDLVideo()
+{
+    quit();
+}
+
+
+/**
+ * @brief      Creates the display window and its renderer
+ * @return     true success
+ */
+bool SDLVideo::init()
+{
+    quit();
+
+    sdl_window = SDL_CreateWindow(
+        "DMG - Emulator",
+        SDL_WINDOWPOS_UNDEFINED,
+        SDL_WINDOWPOS_UNDEFINED,
+        SCREEN_WIDTH,
+        SCREEN_HEIGHT,
+        SDL_WINDOW_SHOWN
+    );
+    if(sdl_window == NULL) {
+        error("Unable to create a display window\n");
+        return false;
+    }
+
+    // Vsync paces the main loop, the emulation runs on its own thread
+    sdl_renderer = SDL_CreateRenderer(
+        sdl_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (sdl_renderer == nullptr) {
+        sdl_renderer = SDL_CreateRenderer(sdl_window, -1, SDL_RENDERER_SOFTWARE);
+    }
+
+    if (sdl_renderer == nullptr) {
+        error("Unable to create a renderer: %s\n", SDL_GetError());
+        return false;
+    }
+
+    sdl_texture = SDL_CreateTexture(
+        sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+        SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    if (sdl_texture == nullptr) {
+        error("Unable to create the screen texture: %s\n", SDL_GetError());
+        return false;
+    }
+
+    memset(frames, 0, sizeof(frames));
+    back_frame = 0;
+    ready_frame = 1;
+    front_frame = 2;
+
+    return true;
+}
+
+
+void SDLVideo::quit()
+{
+    if (sdl_texture) {
+        SDL_DestroyTexture(sdl_texture);
+    }
+
+    if (sdl_renderer) {
+        SDL_DestroyRenderer(sdl_renderer);
+    }
+
+    if (sdl_window) {
+        SDL_DestroyWindow(sdl_window);
+    }
+
+    sdl_texture = nullptr;
+    sdl_renderer = nullptr;
+    sdl_window = nullptr;
+}
+
+
+/**
+ * @brief      Colors are given to the renderer as ARGB8888
+ */
+uint32_t SDLVideo::map_color(uint8_t red, uint8_t green, uint8_t blue)
+{
+    return 0xFF000000 | (red << 16) | (green << 8) | blue;
+}
+
+
+/**
+ * @brief      Gives where to draw the given line
+ * @param[in]  y     The line
+ * @return     First pixel of that line
+ */
+uint32_t *SDLVideo::get_line(size_t y)
+{
+    return frames[back_frame] + (y * SCREEN_WIDTH);
+}
+
+
+/**
+ * @brief      Emulation thread: hands the frame drawn over to the display, never waits
+ */
+void SDLVideo::present()
+{
+    back_frame = ready_frame.exchange(back_frame | FRAME_FRESH) & FRAME_INDEX_MASK;
+}
+
+
+/**
+ * @brief      Main thread: displays the last frame completed, waits for vsync
+ */
+void SDLVideo::refresh()
+{
+    // Take the last frame completed, give back the one displayed
+    if (ready_frame & FRAME_FRESH) {
+        front_frame = ready_frame.exchange(front_frame) & FRAME_INDEX_MASK;
+
+        SDL_UpdateTexture(
+            sdl_texture, nullptr, frames[front_frame], SCREEN_WIDTH * sizeof(uint32_t));
+    }
+
+    SDL_RenderClear(sdl_renderer);
+    SDL_RenderCopy(sdl_renderer, sdl_texture, nullptr, nullptr);
+    SDL_RenderPresent(sdl_renderer);
+}
+
+
+Uint32 SDLVideo::get_window_id()
+{
+    return SDL_GetWindowID(sdl_window);
+}
@@ -0,0 +1,49 @@
+#ifndef SDL_VIDEO_H
+#define SDL_VIDEO_H
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+
+#include "../defines.h"
+#include "../sink.h"
+
+#define FRAME_BUFFER_COUNT      3           // Drawn, ready and displayed frames
+#define FRAME_INDEX_MASK        0b00000011
+#define FRAME_FRESH             0b00000100  // Ready frame not displayed yet
+
+
+/**
+ * @brief      Displays the PPU output in a SDL window
+ *
+ * Frames are drawn in memory by the emulation thread then handed over through
+ * a lock-free triple buffer: the emulation never waits on the window system.
+ * The window and its renderer are only used from the main thread, as SDL
+ * requires, where presenting waits for vsync.
+ */
+class SDLVideo : public VideoSink {
+    SDL_Window *sdl_window;
+    SDL_Renderer *sdl_renderer;
+    SDL_Texture *sdl_texture;
+
+    uint32_t frames[FRAME_BUFFER_COUNT][SCREEN_HEIGHT * SCREEN_WIDTH];
+    size_t back_frame;                  // Drawn by the emulation
+    std::atomic<uint8_t> ready_frame;   // Index and FRAME_FRESH, swapped by both
+    size_t front_frame;                 // Displayed by refresh()
+
+public:
+    SDLVideo();
+    ~SDLVideo();
+
+    bool init();
+    void quit();
+
+    uint32_t map_color(uint8_t red, uint8_t green, uint8_t blue);
+    uint32_t *get_line(size_t y);
+    void present();
+    void refresh();
+
+    Uint32 get_window_id();
+};
+
+#endif /* SDL_VIDEO_H */
@@ -33,11 +33,13 @@ void Input::reset()
     down_pressed = false;
     right_pressed = false;
     left_pressed = false;
+
+    update();
 }
 
 
 /**
- * @brief      Update registers
+ * @brief      Update registers, called when JOYPAD is written or keys changes
  */
 void Input::update()
 {
@@ -61,7 +63,8 @@ void Input::update()
         set_key(&joypad, KEY_RIGHT_A, false);
     }
 
-    mmu->set(JOYPAD, joypad);
+    // Not using set: it would call us back
+    mmu->set_nocheck(JOYPAD, joypad);
 
     // Set joypad interrupt
     if (interrupt_request) {
@@ -72,38 +75,29 @@ void Input::update()
 }
 
 
-void Input::handle(SDL_Event *event)
+/**
+ * @brief      Changes the state of a button
+ * @param[in]  button   The button
+ * @param[in]  pressed  The button state (pressed = true)
+ */
+void Input::set_button(joypad_button button, bool pressed)
 {
-    SDL_Keycode code;
-
-    switch(event->type) {
-    case SDL_KEYDOWN:
-        code = event->key.keysym.sym;
-        switch(code){
-        case SDLK_LEFT:     should_interrupt(code); left_pressed = true;    break;
-        case SDLK_RIGHT:    should_interrupt(code); right_pressed = true;   break;
-        case SDLK_UP:       should_interrupt(code); up_pressed = true;      break;
-        case SDLK_DOWN:     should_interrupt(code); down_pressed = true;    break;
-        case SDLK_a:        should_interrupt(code); a_pressed = true;       break;
-        case SDLK_z:        should_interrupt(code); b_pressed = true;       break;
-        case SDLK_SPACE:    should_interrupt(code); start_pressed = true;   break;
-        case SDLK_RETURN:   should_interrupt(code); select_pressed = true;  break;
-        }
-        break;
-
-    case SDL_KEYUP:
-        switch(event->key.keysym.sym) {
-        case SDLK_LEFT:     left_pressed = false;   break;
-        case SDLK_RIGHT:    right_pressed = false;  break;
-        case SDLK_UP:       up_pressed = false;     break;
-        case SDLK_DOWN:     down_pressed = false;   break;
-        case SDLK_a:        a_pressed = false;      break;
-        case SDLK_z:        b_pressed = false;      break;
-        case SDLK_SPACE:    start_pressed = false;  break;
-        case SDLK_RETURN:   select_pressed = false; break;
-        }
-        break;
+    if (pressed) {
+        should_interrupt(button);
+    }
+
+    switch(button) {
+    case BUTTON_LEFT:   left_pressed = pressed;     break;
+    case BUTTON_RIGHT:  right_pressed = pressed;    break;
+    case BUTTON_UP:     up_pressed = pressed;       break;
+    case BUTTON_DOWN:   down_pressed = pressed;     break;
+    case BUTTON_A:      a_pressed = pressed;        break;
+    case BUTTON_B:      b_pressed = pressed;        break;
+    case BUTTON_START:  start_pressed = pressed;    break;
+    case BUTTON_SELECT: select_pressed = pressed;   break;
     }
+
+    update();
 }
 
 
@@ -135,26 +129,26 @@ void Input::set_key(uint8_t *joypad, size_t key, bool pressed)
 
 /**
  * @brief      Determines if an interrupt can occur
- * @param[in]  key   The key being pressed
+ * @param[in]  button   The button being pressed
  */
-void Input::should_interrupt(size_t key)
+void Input::should_interrupt(joypad_button button)
 {
     uint8_t joypad = mmu->get(JOYPAD);
 
     if (get_selected(joypad, SELECT_BUTTON_KEY_MASKS)) {
-        if (key == SDLK_a ||
-            key == SDLK_b ||
-            key == SDLK_SPACE ||
-            key == SDLK_RETURN ) {
+        if (button == BUTTON_A ||
+            button == BUTTON_B ||
+            button == BUTTON_START ||
+            button == BUTTON_SELECT ) {
             interrupt_request = true;
         }
     }
 
     if (get_selected(joypad, SELECT_DIRECTION_KEY_MASKS)) {
-        if (key == SDLK_LEFT ||
-            key == SDLK_RIGHT ||
-            key == SDLK_UP ||
-            key == SDLK_DOWN ) {
+        if (button == BUTTON_LEFT ||
+            button == BUTTON_RIGHT ||
+            button == BUTTON_UP ||
+            button == BUTTON_DOWN ) {
             interrupt_request = true;
         }
     }
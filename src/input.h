@@ -1,7 +1,6 @@
 #ifndef INPUT_H
 #define INPUT_H
 
-#include <SDL2/SDL.h>
 #include <iostream>
 #include <fstream>
 
@@ -16,7 +15,6 @@ class Input {
     MMU *mmu;
 
     bool interrupt_request;
-    SDL_Keycode last_key;
 
     bool a_pressed;
     bool b_pressed;
@@ -34,9 +32,9 @@ public:
     bool init();
     void reset();
     void update();
-    void handle(SDL_Event *event);
+    void set_button(joypad_button button, bool pressed);
 
-    void should_interrupt(size_t key);
+    void should_interrupt(joypad_button button);
     bool get_selected(uint8_t joypad, uint8_t line_mask);
     void set_key(uint8_t *joypad, size_t key, bool pressed);
 
@@ -6,7 +6,7 @@
 #include <vector>
 
 #include "log.h"
-#include "dmg.h"
+#include "gui/frontend.h"
 
 #include "main.h"
 
@@ -17,7 +17,11 @@ void show_usage()
               << "Options:\n"
               << "\t-h,--help\t\tShow this help message\n"
               << "\t-b,--boot BOOT\tSpecifies BOOT ROM\n"
-              << "\t-p,--palette PALETTE\tndex of color palette to use\n";
+              << "\t-p,--palette PALETTE\tndex of color palette to use\n"
+              << "\t-a,--accurate\t\tDraw pixel by pixel (slower)\n"
+              << "\t-i,--interval N\t\tDraw one frame every N frames\n"
+              << "\t-l,--latency MS\t\tSound kept queued\n"
+              << "\t-m,--mute\t\tNo sound at all (faster)\n";
 }
 
 
@@ -25,13 +29,17 @@ int main(int argc, char *argv[])
 {
     info("DMG emulation\n");
 
-    if (argc < 2 || argc > 6) {
+    if (argc < 2 || argc > 12) {
         show_usage();
     }
 
     std::string rom;
     std::string boot = "";
     std::string palette = "0";
+    bool accurate = false;
+    std::string interval = "1";
+    std::string latency = "";
+    bool mute = false;
 
     for (int i=1; i<argc; ++i) {
         std::string arg = argv[i];
@@ -54,6 +62,26 @@ int main(int argc, char *argv[])
                 show_usage();
                 return EXIT_FAILURE;
             }
+        } else if ((arg == "-a") || (arg == "--accurate")) {
+            accurate = true;
+        } else if ((arg == "-i") || (arg == "--interval")) {
+            if (i + 1 < argc) {
+                interval = argv[++i];
+            } else {
+                error("--interval option requires one argument\n");
+                show_usage();
+                return EXIT_FAILURE;
+            }
+        } else if ((arg == "-l") || (arg == "--latency")) {
+            if (i + 1 < argc) {
+                latency = argv[++i];
+            } else {
+                error("--latency option requires one argument\n");
+                show_usage();
+                return EXIT_FAILURE;
+            }
+        } else if ((arg == "-m") || (arg == "--mute")) {
+            mute = true;
         } else if (i == argc - 1) {
             rom = argv[i];
         } else {
@@ -63,17 +91,31 @@ int main(int argc, char *argv[])
         }
     }
 
-    DMG *dmg = new DMG();
-    if (!dmg->init(boot.c_str(), rom.c_str())) {
+    Frontend *frontend = new Frontend();
+    if (!frontend->init(boot.c_str(), rom.c_str())) {
         return EXIT_FAILURE;
     }
 
     uint8_t palette_id = palette.c_str()[0] - '0';
-    dmg->set_palette(palette_id);
+    frontend->set_palette(palette_id);
+
+    if (accurate) {
+        frontend->set_renderer(RENDERER_FIFO);
+    }
+
+    frontend->set_render_interval(atoi(interval.c_str()));
+
+    if (!latency.empty()) {
+        frontend->set_audio_latency(atoi(latency.c_str()));
+    }
+
+    if (mute) {
+        frontend->disable_audio();
+    }
 
-    int status = dmg->run();
+    int status = frontend->run();
 
-    delete dmg;
+    delete frontend;
 
     return status;
 }
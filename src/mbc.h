@@ -7,6 +7,15 @@
 #include <fstream>
 
 
+// Registers common to bank controllers
+#define RAM_ENABLE_START            0x0000
+#define RAM_ENABLE_END              0x1FFF
+#define ROM_BANK_NUMBER_START       0x2000
+#define ROM_BANK_NUMBER_END         0x3FFF
+#define RAM_BANK_NUMBER_START       0x4000
+#define RAM_BANK_NUMBER_END         0x5FFF
+
+
 /**
  * @brief      Abstract class to Memory Bank controllers
  *
@@ -14,18 +23,38 @@
  * switchable memory banks.
  */
 class MBC {
+protected:
+    // Banks currently mapped, only updated when bank registers change
+    const uint8_t *rom0_bank;
+    const uint8_t *rom1_bank;
+    uint8_t *ram_bank;
+
 public:
-    uint8_t *memory;
+    const uint8_t *memory;      // The ROM image, owned by the cartridge
     uint8_t *ram;
 
     size_t ram_size;
 
+    MBC() :
+        rom0_bank(nullptr), rom1_bank(nullptr), ram_bank(nullptr),
+        memory(nullptr), ram(nullptr), ram_size(0) {};
     virtual ~MBC() = default;
 
     virtual void init() = 0;
     virtual uint8_t get(uint16_t address) = 0;
     virtual bool set(uint16_t address, uint8_t value) = 0;
-    virtual bool load(size_t mb_index, const uint8_t *rom) = 0;
+    virtual bool load(const uint8_t *rom, size_t bank_count) = 0;
+
+    // Banks currently mapped, nullptr when accesses have to use get/set
+    const uint8_t *get_rom0_bank() { return rom0_bank; };
+    const uint8_t *get_rom1_bank() { return rom1_bank; };
+    uint8_t *get_ram_bank() { return ram_bank; };
+
+    // Cartridge real-time clock following the emulated one, if any
+    virtual void reset_clock() {};
+    virtual void adjust_clocks(size_t /*adjustment*/) {};
+    virtual void save_clock(std::ofstream & /*file*/) {};
+    virtual void load_clock(std::ifstream & /*file*/) {};
 
     virtual void serialize(std::ofstream &file) = 0;
     virtual void deserialize(std::ifstream &file) = 0;
@@ -1,7 +1,5 @@
 #include "mbc1.h"
 
-#include <string.h>
-
 #include "../mmu.h"
 #include "../log.h"
 
@@ -12,8 +10,6 @@ MBC1::MBC1(size_t rom_mbc_count, uint8_t ram_type)
     this->rom_mbc_count = rom_mbc_count;
     this->ram_mbc_count = Cartridge::get_ram_bank_count(ram_type);
 
-    rom_mbc_count = 0;
-
     rom_mode_selected = true;
     ram_enabled = false;
 
@@ -24,17 +20,18 @@ MBC1::MBC1(size_t rom_mbc_count, uint8_t ram_type)
 
 MBC1::~MBC1()
 {
-    delete[] memory;
     delete[] ram;
 }
 
 
 void MBC1::init()
 {
-    memory = new uint8_t[rom_mbc_count * MBC_SIZE];
+    delete[] ram;
     ram = new uint8_t[ram_mbc_count * RAM_MBC_SIZE];
 
     ram_size = ram_mbc_count * RAM_MBC_SIZE;
+
+    map_banks();
 }
 
 
@@ -46,12 +43,11 @@ void MBC1::init()
 uint8_t MBC1::get(uint16_t address)
 {
     if (address <= ROM0_END) {
-        return memory[address % MBC_SIZE];
+        return rom0_bank[address];
     } else if (address <= ROM1_END) {
-        return memory[(get_selected_rom_bank() * MBC_SIZE) + (address % MBC_SIZE)];
-    } else if (ram_enabled) {
-        address = (address - SRAM_START) % RAM_MBC_SIZE;
-        return ram[(get_selected_ram_bank() * RAM_MBC_SIZE) + address];
+        return rom1_bank[address - ROM1_START];
+    } else if (ram_bank != nullptr) {
+        return ram_bank[(address - SRAM_START) % RAM_MBC_SIZE];
     } else {
         return 0;
     }
@@ -59,24 +55,35 @@ uint8_t MBC1::get(uint16_t address)
 
 
 /**
- * @brief      Stores the given 16k of ROM into the MBC at the given index
- * @param[in]  mb_index  The memory bank index
- * @param[in]  rom        The rom
+ * @brief      Banks are read straight from the ROM image
+ * @param[in]  rom         The ROM image
+ * @param[in]  bank_count  How many 16k banks it holds
  * @return     true if loaded with success
  */
-bool MBC1::load(size_t mb_index, const uint8_t *rom)
+bool MBC1::load(const uint8_t *rom, size_t bank_count)
 {
-    if (mb_index >= rom_mbc_count) {
-        error("MBC1 have at most %zu memory bank(s)\n", rom_mbc_count);
-        return false;
+    // Oversized dump: only the banks the header declares are used
+    if (bank_count > rom_mbc_count) {
+        error("MBC1 have at most %zu memory bank(s), ignoring the other ones\n", rom_mbc_count);
+        bank_count = rom_mbc_count;
     }
 
-    memcpy(memory + (mb_index * MBC_SIZE), rom, MBC_SIZE);
+    // Truncated dump: selecting a missing bank mirrors an existing one
+    rom_mbc_count = bank_count;
+    memory = rom;
+
+    map_banks();
 
     return true;
 }
 
 
+/**
+ * @brief      Writes to the bank registers or the RAM
+ * @param[in]  address  The address
+ * @param[in]  value    The value
+ * @return     true if the banks mapped changed
+ */
 bool MBC1::set(uint16_t address, uint8_t value)
 {
     // Enable RAM
@@ -109,9 +116,38 @@ bool MBC1::set(uint16_t address, uint8_t value)
     else if (address >= SRAM_START && address <= SRAM_END) {
         address = (address - SRAM_START) % RAM_MBC_SIZE;
         ram[(get_selected_ram_bank() * RAM_MBC_SIZE) + address] = value;
+        return false;
     }
 
-    return true;
+    return map_banks();
+}
+
+
+/**
+ * @brief      Points the banks to the ones selected, RAM is nullptr when disabled
+ * @return     true if any of them changed
+ */
+bool MBC1::map_banks()
+{
+    const uint8_t *rom0 = nullptr;
+    const uint8_t *rom1 = nullptr;
+    if (memory != nullptr) {
+        rom0 = memory;
+        rom1 = memory + (get_selected_rom_bank() * MBC_SIZE);
+    }
+
+    uint8_t *sram = nullptr;
+    if (ram_enabled && ram != nullptr) {
+        sram = ram + (get_selected_ram_bank() * RAM_MBC_SIZE);
+    }
+
+    bool changed = rom0 != rom0_bank || rom1 != rom1_bank || sram != ram_bank;
+
+    rom0_bank = rom0;
+    rom1_bank = rom1;
+    ram_bank = sram;
+
+    return changed;
 }
 
 
@@ -141,7 +177,7 @@ size_t MBC1::get_selected_rom_bank()
  */
 size_t MBC1::get_selected_ram_bank()
 {
-    return ram_bank_select;
+    return ram_bank_select % ram_mbc_count;
 }
 
 
@@ -156,7 +192,6 @@ void MBC1::serialize(std::ofstream &file)
     file.write(reinterpret_cast<char*>(&rom_bank_select), sizeof(uint8_t));
     file.write(reinterpret_cast<char*>(&ram_bank_select), sizeof(uint8_t));
 
-    file.write(reinterpret_cast<char*>(memory), sizeof(uint8_t) * rom_mbc_count * MBC_SIZE);
     file.write(reinterpret_cast<char*>(ram), sizeof(uint8_t) * ram_mbc_count * RAM_MBC_SIZE);
 }
 
@@ -174,6 +209,5 @@ void MBC1::deserialize(std::ifstream &file)
 
     init();
 
-    file.read(reinterpret_cast<char*>(memory), sizeof(uint8_t) * rom_mbc_count * MBC_SIZE);
     file.read(reinterpret_cast<char*>(ram), sizeof(uint8_t) * ram_mbc_count * RAM_MBC_SIZE);
 }
@@ -4,12 +4,6 @@
 #include "../mbc.h"
 
 
-#define RAM_ENABLE_START            0x0000
-#define RAM_ENABLE_END              0x1FFF
-#define ROM_BANK_NUMBER_START       0x2000
-#define ROM_BANK_NUMBER_END         0x3FFF
-#define RAM_BANK_NUMBER_START       0x4000
-#define RAM_BANK_NUMBER_END         0x5FFF
 #define ROM_RAM_MODE_SELECT_START   0x6000
 #define ROM_RAM_MODE_SELECT_END     0x7FFF
 
@@ -34,6 +28,7 @@ class MBC1 : public MBC {
 
     size_t get_selected_rom_bank();
     size_t get_selected_ram_bank();
+    bool map_banks();
 
 public:
     MBC1(size_t rom_mbc_count, uint8_t ram_type);
@@ -42,7 +37,7 @@ public:
     void init();
     uint8_t get(uint16_t address);
     bool set(uint16_t address, uint8_t value);
-    bool load(size_t mb_index, const uint8_t *rom);
+    bool load(const uint8_t *rom, size_t bank_count);
 
     void serialize(std::ofstream &file);
     void deserialize(std::ifstream &file);
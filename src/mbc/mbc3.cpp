@@ -0,0 +1,405 @@
+#include "mbc3.h"
+
+#include <string.h>
+#include <time.h>
+
+#include "../mmu.h"
+#include "../dmg.h"
+#include "../log.h"
+
+
+// Bits kept when writing clock registers
+static const uint8_t clock_register_masks[RTC_REGISTER_COUNT] = {
+    0x3F, 0x3F, 0x1F, 0xFF, RTC_DAY_CARRY | RTC_HALT | RTC_DAY_BIT_8
+};
+
+
+MBC3::MBC3(size_t rom_mbc_count, uint8_t ram_type, bool has_clock, DMG *dmg)
+{
+    debug("MBC3 ROM: %zu banks RAM: 0x%02X clock: %d\n", rom_mbc_count, ram_type, has_clock);
+    this->rom_mbc_count = rom_mbc_count;
+    this->ram_mbc_count = Cartridge::get_ram_bank_count(ram_type);
+    this->has_clock = has_clock;
+    this->dmg = dmg;
+
+    ram_enabled = false;
+    latch_ready = false;
+
+    rom_bank_select = 0;
+    ram_bank_select = 0;
+
+    memset(clock_registers, 0, sizeof(clock_registers));
+    memset(latched_registers, 0, sizeof(latched_registers));
+    clock_cycles = 0;
+    clock_update = (dmg != nullptr) ? dmg->get_current_clock() : 0;
+}
+
+
+MBC3::~MBC3()
+{
+    delete[] ram;
+}
+
+
+void MBC3::init()
+{
+    delete[] ram;
+    ram = new uint8_t[ram_mbc_count * RAM_MBC_SIZE];
+
+    ram_size = ram_mbc_count * RAM_MBC_SIZE;
+
+    map_banks();
+}
+
+
+/**
+ * @brief      Give value from MBC
+ * @param[in]  address  Requested address
+ * @return     The value, latched clock register when one is selected
+ */
+uint8_t MBC3::get(uint16_t address)
+{
+    if (address <= ROM0_END) {
+        return rom0_bank[address];
+    } else if (address <= ROM1_END) {
+        return rom1_bank[address - ROM1_START];
+    } else if (ram_bank != nullptr) {
+        return ram_bank[(address - SRAM_START) % RAM_MBC_SIZE];
+    } else if (is_clock_selected()) {
+        return latched_registers[ram_bank_select - RTC_SECONDS];
+    } else {
+        return 0;
+    }
+}
+
+
+/**
+ * @brief      Banks are read straight from the ROM image
+ * @param[in]  rom         The ROM image
+ * @param[in]  bank_count  How many 16k banks it holds
+ * @return     true if loaded with success
+ */
+bool MBC3::load(const uint8_t *rom, size_t bank_count)
+{
+    // Oversized dump: only the banks the header declares are used
+    if (bank_count > rom_mbc_count) {
+        error("MBC3 have at most %zu memory bank(s), ignoring the other ones\n", rom_mbc_count);
+        bank_count = rom_mbc_count;
+    }
+
+    // Truncated dump: selecting a missing bank mirrors an existing one
+    rom_mbc_count = bank_count;
+    memory = rom;
+
+    map_banks();
+
+    return true;
+}
+
+
+/**
+ * @brief      Writes to the bank registers, the RAM or the clock
+ * @param[in]  address  The address
+ * @param[in]  value    The value
+ * @return     true if the banks mapped changed
+ */
+bool MBC3::set(uint16_t address, uint8_t value)
+{
+    // Enable RAM and clock
+    if (address <= RAM_ENABLE_END) {
+        ram_enabled = (value & 0x0F) == 0x0A;
+    }
+
+    // ROM bank select
+    else if (address <= ROM_BANK_NUMBER_END) {
+        rom_bank_select = value & MBC3_ROM_BANK_NUMBER_MASK;
+    }
+
+    // RAM bank or clock register select
+    else if (address <= RAM_BANK_NUMBER_END) {
+        ram_bank_select = value;
+    }
+
+    // Latch clock data: 0x00 then 0x01
+    else if (address <= LATCH_CLOCK_END) {
+        if (latch_ready && value == 0x01) {
+            catch_up();
+            memcpy(latched_registers, clock_registers, sizeof(clock_registers));
+        }
+
+        latch_ready = (value == 0x00);
+        return false;
+    }
+
+    // Write to RAM or clock
+    else if (address >= SRAM_START && address <= SRAM_END) {
+        if (ram_bank != nullptr) {
+            ram_bank[(address - SRAM_START) % RAM_MBC_SIZE] = value;
+        } else if (is_clock_selected()) {
+            catch_up();
+
+            size_t index = ram_bank_select - RTC_SECONDS;
+            clock_registers[index] = value & clock_register_masks[index];
+
+            // Seconds restart counting
+            if (ram_bank_select == RTC_SECONDS) {
+                clock_cycles = 0;
+            }
+        }
+        return false;
+    }
+
+    return map_banks();
+}
+
+
+/**
+ * @brief      Compute selected ROM bank
+ * @return     The selected rom bank.
+ */
+size_t MBC3::get_selected_rom_bank()
+{
+    size_t bank = rom_bank_select;
+    if (bank == 0) {
+        bank = 1;
+    }
+
+    return bank % rom_mbc_count;
+}
+
+
+/**
+ * @brief      Points the banks to the ones selected
+ *
+ * RAM is nullptr when disabled or when a clock register is selected.
+ * @return     true if any of them changed
+ */
+bool MBC3::map_banks()
+{
+    const uint8_t *rom0 = nullptr;
+    const uint8_t *rom1 = nullptr;
+    if (memory != nullptr) {
+        rom0 = memory;
+        rom1 = memory + (get_selected_rom_bank() * MBC_SIZE);
+    }
+
+    uint8_t *sram = nullptr;
+    if (ram_enabled && ram != nullptr && ram_bank_select < MBC3_RAM_BANK_COUNT) {
+        sram = ram + ((ram_bank_select % ram_mbc_count) * RAM_MBC_SIZE);
+    }
+
+    bool changed = rom0 != rom0_bank || rom1 != rom1_bank || sram != ram_bank;
+
+    rom0_bank = rom0;
+    rom1_bank = rom1;
+    ram_bank = sram;
+
+    return changed;
+}
+
+
+/**
+ * @brief      Indicates if RAM accesses go to a clock register
+ */
+bool MBC3::is_clock_selected()
+{
+    return ram_enabled && has_clock &&
+        ram_bank_select >= RTC_SECONDS && ram_bank_select <= RTC_DAY_HIGH;
+}
+
+
+/**
+ * @brief      Brings the clock up to the current clock before it is accessed
+ */
+void MBC3::catch_up()
+{
+    // Not running inside a DMG, there is no clock to follow
+    if (dmg == nullptr) {
+        return;
+    }
+
+    update_clock(dmg->get_current_clock());
+}
+
+
+/**
+ * @brief      Counts the cycles elapsed until the given clock, unless halted
+ * @param[in]  clock  The emulated clock
+ */
+void MBC3::update_clock(size_t clock)
+{
+    if (clock < clock_update) {
+        return;
+    }
+
+    if (!(get_clock_register(RTC_DAY_HIGH) & RTC_HALT)) {
+        clock_cycles += clock - clock_update;
+
+        advance_clock(clock_cycles / RTC_CLOCK_RATE);
+        clock_cycles %= RTC_CLOCK_RATE;
+    }
+
+    clock_update = clock;
+}
+
+
+/**
+ * @brief      Adds seconds to the clock registers, days overflow sets the carry
+ * @param[in]  seconds  The seconds
+ */
+void MBC3::advance_clock(size_t seconds)
+{
+    if (seconds == 0) {
+        return;
+    }
+
+    size_t total = get_clock_register(RTC_SECONDS) + seconds;
+    get_clock_register(RTC_SECONDS) = total % 60;
+
+    total = get_clock_register(RTC_MINUTES) + (total / 60);
+    get_clock_register(RTC_MINUTES) = total % 60;
+
+    total = get_clock_register(RTC_HOURS) + (total / 60);
+    get_clock_register(RTC_HOURS) = total % 24;
+
+    size_t days = get_days() + (total / 24);
+    if (days >= RTC_DAY_COUNT) {
+        get_clock_register(RTC_DAY_HIGH) |= RTC_DAY_CARRY;
+        days %= RTC_DAY_COUNT;
+    }
+
+    uint8_t &day_high = get_clock_register(RTC_DAY_HIGH);
+    day_high = (day_high & ~RTC_DAY_BIT_8) | ((days >> 8) & RTC_DAY_BIT_8);
+    get_clock_register(RTC_DAY_LOW) = days & 0xFF;
+}
+
+
+size_t MBC3::get_days()
+{
+    size_t high = get_clock_register(RTC_DAY_HIGH) & RTC_DAY_BIT_8;
+
+    return (high << 8) | get_clock_register(RTC_DAY_LOW);
+}
+
+
+/**
+ * @brief      Emulated clocks restart from 0, time counted until now is kept
+ */
+void MBC3::reset_clock()
+{
+    catch_up();
+
+    clock_update = 0;
+}
+
+
+void MBC3::adjust_clocks(size_t adjustment)
+{
+    // A clock not accessed for long would fall behind the adjustment
+    if (dmg != nullptr) {
+        update_clock(dmg->get_system_clock());
+    }
+
+    clock_update -= adjustment;
+}
+
+
+/**
+ * @brief      Appends the clock to the battery save
+ *
+ * Same layout as other emulators: live then latched registers on 32 bits,
+ * then the host time on 64 bits. That time is ignored when loading as the
+ * clock only follows emulated cycles.
+ * @param      file  The save file, after the RAM
+ */
+void MBC3::save_clock(std::ofstream &file)
+{
+    if (!has_clock) {
+        return;
+    }
+
+    catch_up();
+
+    for (size_t i=0; i<RTC_REGISTER_COUNT; i++) {
+        uint32_t value = clock_registers[i];
+        file.write(reinterpret_cast<char*>(&value), sizeof(uint32_t));
+    }
+
+    for (size_t i=0; i<RTC_REGISTER_COUNT; i++) {
+        uint32_t value = latched_registers[i];
+        file.write(reinterpret_cast<char*>(&value), sizeof(uint32_t));
+    }
+
+    uint64_t timestamp = time(nullptr);
+    file.write(reinterpret_cast<char*>(&timestamp), sizeof(uint64_t));
+}
+
+
+/**
+ * @brief      Restores the clock from the battery save, if it has one
+ * @param      file  The save file, after the RAM
+ */
+void MBC3::load_clock(std::ifstream &file)
+{
+    if (!has_clock) {
+        return;
+    }
+
+    uint32_t values[RTC_REGISTER_COUNT * 2];
+    file.read(reinterpret_cast<char*>(values), sizeof(values));
+    if (!file) {
+        return;
+    }
+
+    for (size_t i=0; i<RTC_REGISTER_COUNT; i++) {
+        clock_registers[i] = values[i] & clock_register_masks[i];
+        latched_registers[i] = values[RTC_REGISTER_COUNT + i] & clock_register_masks[i];
+    }
+
+    clock_cycles = 0;
+    clock_update = (dmg != nullptr) ? dmg->get_current_clock() : 0;
+}
+
+
+void MBC3::serialize(std::ofstream &file)
+{
+    file.write(reinterpret_cast<char*>(&rom_mbc_count), sizeof(size_t));
+    file.write(reinterpret_cast<char*>(&ram_mbc_count), sizeof(size_t));
+    file.write(reinterpret_cast<char*>(&has_clock), sizeof(bool));
+
+    file.write(reinterpret_cast<char*>(&ram_enabled), sizeof(bool));
+    file.write(reinterpret_cast<char*>(&latch_ready), sizeof(bool));
+
+    file.write(reinterpret_cast<char*>(&rom_bank_select), sizeof(uint8_t));
+    file.write(reinterpret_cast<char*>(&ram_bank_select), sizeof(uint8_t));
+
+    file.write(reinterpret_cast<char*>(clock_registers), sizeof(uint8_t) * RTC_REGISTER_COUNT);
+    file.write(reinterpret_cast<char*>(latched_registers), sizeof(uint8_t) * RTC_REGISTER_COUNT);
+    file.write(reinterpret_cast<char*>(&clock_cycles), sizeof(size_t));
+    file.write(reinterpret_cast<char*>(&clock_update), sizeof(size_t));
+
+    file.write(reinterpret_cast<char*>(ram), sizeof(uint8_t) * ram_mbc_count * RAM_MBC_SIZE);
+}
+
+
+void MBC3::deserialize(std::ifstream &file)
+{
+    file.read(reinterpret_cast<char*>(&rom_mbc_count), sizeof(size_t));
+    file.read(reinterpret_cast<char*>(&ram_mbc_count), sizeof(size_t));
+    file.read(reinterpret_cast<char*>(&has_clock), sizeof(bool));
+
+    file.read(reinterpret_cast<char*>(&ram_enabled), sizeof(bool));
+    file.read(reinterpret_cast<char*>(&latch_ready), sizeof(bool));
+
+    file.read(reinterpret_cast<char*>(&rom_bank_select), sizeof(uint8_t));
+    file.read(reinterpret_cast<char*>(&ram_bank_select), sizeof(uint8_t));
+
+    file.read(reinterpret_cast<char*>(clock_registers), sizeof(uint8_t) * RTC_REGISTER_COUNT);
+    file.read(reinterpret_cast<char*>(latched_registers), sizeof(uint8_t) * RTC_REGISTER_COUNT);
+    file.read(reinterpret_cast<char*>(&clock_cycles), sizeof(size_t));
+    file.read(reinterpret_cast<char*>(&clock_update), sizeof(size_t));
+
+    init();
+
+    file.read(reinterpret_cast<char*>(ram), sizeof(uint8_t) * ram_mbc_count * RAM_MBC_SIZE);
+}
@@ -0,0 +1,91 @@
+#ifndef MBC3_H
+#define MBC3_H
+
+#include "../mbc.h"
+
+
+class DMG;
+
+
+#define LATCH_CLOCK_START           0x6000
+#define LATCH_CLOCK_END             0x7FFF
+
+#define MBC3_ROM_BANK_NUMBER_MASK   0b01111111
+#define MBC3_RAM_BANK_COUNT         4
+
+// Clock registers, selected like RAM banks
+#define RTC_SECONDS                 0x08
+#define RTC_MINUTES                 0x09
+#define RTC_HOURS                   0x0A
+#define RTC_DAY_LOW                 0x0B
+#define RTC_DAY_HIGH                0x0C
+#define RTC_REGISTER_COUNT          5
+
+// Day high register
+#define RTC_DAY_BIT_8               0b00000001
+#define RTC_HALT                    0b01000000
+#define RTC_DAY_CARRY               0b10000000
+
+#define RTC_CLOCK_RATE              4194304     // CPU clocks per second
+#define RTC_DAY_COUNT               512
+
+
+/**
+ * @brief      Up to 2MB of ROM, 32kB of RAM and an optional real-time clock
+ *
+ * The clock counts emulated cycles, not host time: it only moves forward
+ * when read, latched or written, and stays deterministic whatever the
+ * emulation speed.
+ */
+class MBC3 : public MBC {
+    DMG *dmg;
+
+    size_t rom_mbc_count;
+    size_t ram_mbc_count;
+    bool has_clock;
+
+    bool ram_enabled;       // Clock registers as well
+    bool latch_ready;       // 0x00 written, 0x01 latches
+
+    uint8_t rom_bank_select;
+    uint8_t ram_bank_select;    // RAM bank or clock register
+
+    uint8_t clock_registers[RTC_REGISTER_COUNT];
+    uint8_t latched_registers[RTC_REGISTER_COUNT];
+    size_t clock_cycles;    // Counted toward the next second
+    size_t clock_update;    // Emulated clock registers are up to date with
+
+    size_t get_selected_rom_bank();
+    bool map_banks();
+    bool is_clock_selected();
+
+    /**
+     * @brief      Live clock register from its select value
+     */
+    uint8_t &get_clock_register(uint8_t select) { return clock_registers[select - RTC_SECONDS]; };
+
+    void catch_up();
+    void advance_clock(size_t seconds);
+    size_t get_days();
+
+public:
+    MBC3(size_t rom_mbc_count, uint8_t ram_type, bool has_clock, DMG *dmg);
+    ~MBC3();
+
+    void init();
+    uint8_t get(uint16_t address);
+    bool set(uint16_t address, uint8_t value);
+    bool load(const uint8_t *rom, size_t bank_count);
+
+    void update_clock(size_t clock);
+
+    void reset_clock();
+    void adjust_clocks(size_t adjustment);
+    void save_clock(std::ofstream &file);
+    void load_clock(std::ifstream &file);
+
+    void serialize(std::ofstream &file);
+    void deserialize(std::ifstream &file);
+};
+
+#endif /* MBC3_H */
@@ -0,0 +1,187 @@
+#include "mbc5.h"
+
+#include "../mmu.h"
+#include "../log.h"
+
+
+MBC5::MBC5(size_t rom_mbc_count, uint8_t ram_type)
+{
+    debug("MBC5 ROM: %zu banks RAM: 0x%02X\n", rom_mbc_count, ram_type);
+    this->rom_mbc_count = rom_mbc_count;
+    this->ram_mbc_count = Cartridge::get_ram_bank_count(ram_type);
+
+    ram_enabled = false;
+
+    rom_bank_select = 1;
+    ram_bank_select = 0;
+
+    for (size_t i=0; i<MBC5_ROM_BANK_COUNT; i++) {
+        rom_banks[i] = nullptr;
+    }
+
+    for (size_t i=0; i<MBC5_RAM_BANK_COUNT; i++) {
+        ram_banks[i] = nullptr;
+    }
+}
+
+
+MBC5::~MBC5()
+{
+    delete[] ram;
+}
+
+
+void MBC5::init()
+{
+    delete[] ram;
+    ram = new uint8_t[ram_mbc_count * RAM_MBC_SIZE];
+
+    ram_size = ram_mbc_count * RAM_MBC_SIZE;
+
+    for (size_t i=0; i<MBC5_RAM_BANK_COUNT; i++) {
+        ram_banks[i] = ram + ((i % ram_mbc_count) * RAM_MBC_SIZE);
+    }
+
+    map_banks();
+}
+
+
+/**
+ * @brief      Give value from MBC
+ * @param[in]  address  Requested address
+ * @return     Address to an immutable value
+ */
+uint8_t MBC5::get(uint16_t address)
+{
+    if (address <= ROM0_END) {
+        return rom0_bank[address];
+    } else if (address <= ROM1_END) {
+        return rom1_bank[address - ROM1_START];
+    } else if (ram_bank != nullptr) {
+        return ram_bank[(address - SRAM_START) % RAM_MBC_SIZE];
+    } else {
+        return 0;
+    }
+}
+
+
+/**
+ * @brief      Banks are read straight from the ROM image
+ * @param[in]  rom         The ROM image
+ * @param[in]  bank_count  How many 16k banks it holds
+ * @return     true if loaded with success
+ */
+bool MBC5::load(const uint8_t *rom, size_t bank_count)
+{
+    // Oversized dump: only the banks the header declares are used
+    if (bank_count > rom_mbc_count) {
+        error("MBC5 have at most %zu memory bank(s), ignoring the other ones\n", rom_mbc_count);
+        bank_count = rom_mbc_count;
+    }
+
+    // Truncated dump: selecting a missing bank mirrors an existing one
+    rom_mbc_count = bank_count;
+    memory = rom;
+
+    for (size_t i=0; i<MBC5_ROM_BANK_COUNT; i++) {
+        rom_banks[i] = memory + ((i % rom_mbc_count) * MBC_SIZE);
+    }
+
+    map_banks();
+
+    return true;
+}
+
+
+/**
+ * @brief      Writes to the bank registers or the RAM
+ * @param[in]  address  The address
+ * @param[in]  value    The value
+ * @return     true if the banks mapped changed
+ */
+bool MBC5::set(uint16_t address, uint8_t value)
+{
+    // Enable RAM
+    if (address <= RAM_ENABLE_END) {
+        ram_enabled = (value & 0x0F) == 0x0A;
+    }
+
+    // ROM bank select, lower 8 bits
+    else if (address <= ROM_BANK_LOW_END) {
+        rom_bank_select = (rom_bank_select & 0x100) | value;
+    }
+
+    // ROM bank select, bit 8
+    else if (address <= ROM_BANK_NUMBER_END) {
+        rom_bank_select = ((value & 0x01) << 8) | (rom_bank_select & 0xFF);
+    }
+
+    // RAM bank select
+    else if (address <= RAM_BANK_NUMBER_END) {
+        ram_bank_select = value & MBC5_RAM_BANK_NUMBER_MASK;
+    }
+
+    // Write to RAM
+    else if (address >= SRAM_START && address <= SRAM_END) {
+        if (ram_bank != nullptr) {
+            ram_bank[(address - SRAM_START) % RAM_MBC_SIZE] = value;
+        }
+        return false;
+    }
+
+    return map_banks();
+}
+
+
+/**
+ * @brief      Points the banks to the ones selected, RAM is nullptr when disabled
+ * Bank 0 can be selected for ROM1, there is no translation to bank 1
+ * @return     true if any of them changed
+ */
+bool MBC5::map_banks()
+{
+    const uint8_t *rom1 = rom_banks[rom_bank_select];
+
+    uint8_t *sram = nullptr;
+    if (ram_enabled) {
+        sram = ram_banks[ram_bank_select];
+    }
+
+    bool changed = memory != rom0_bank || rom1 != rom1_bank || sram != ram_bank;
+
+    rom0_bank = memory;
+    rom1_bank = rom1;
+    ram_bank = sram;
+
+    return changed;
+}
+
+
+void MBC5::serialize(std::ofstream &file)
+{
+    file.write(reinterpret_cast<char*>(&rom_mbc_count), sizeof(size_t));
+    file.write(reinterpret_cast<char*>(&ram_mbc_count), sizeof(size_t));
+
+    file.write(reinterpret_cast<char*>(&ram_enabled), sizeof(bool));
+
+    file.write(reinterpret_cast<char*>(&rom_bank_select), sizeof(uint16_t));
+    file.write(reinterpret_cast<char*>(&ram_bank_select), sizeof(uint8_t));
+
+    file.write(reinterpret_cast<char*>(ram), sizeof(uint8_t) * ram_mbc_count * RAM_MBC_SIZE);
+}
+
+
+void MBC5::deserialize(std::ifstream &file)
+{
+    file.read(reinterpret_cast<char*>(&rom_mbc_count), sizeof(size_t));
+    file.read(reinterpret_cast<char*>(&ram_mbc_count), sizeof(size_t));
+
+    file.read(reinterpret_cast<char*>(&ram_enabled), sizeof(bool));
+
+    file.read(reinterpret_cast<char*>(&rom_bank_select), sizeof(uint16_t));
+    file.read(reinterpret_cast<char*>(&ram_bank_select), sizeof(uint8_t));
+
+    init();
+
+    file.read(reinterpret_cast<char*>(ram), sizeof(uint8_t) * ram_mbc_count * RAM_MBC_SIZE);
+}
@@ -0,0 +1,49 @@
+#ifndef MBC5_H
+#define MBC5_H
+
+#include "../mbc.h"
+
+
+#define ROM_BANK_LOW_END            0x2FFF  // Then bit 8 up to 0x3FFF
+
+#define MBC5_ROM_BANK_COUNT         512
+#define MBC5_RAM_BANK_COUNT         16
+#define MBC5_RAM_BANK_NUMBER_MASK   0b00001111  // Bit 3 drives the rumble motor
+
+
+/**
+ * @brief      Up to 8MB of ROM and 128kB of RAM
+ *
+ * ROM bank numbers are 9 bits long and bank 0 can be mapped in ROM1.
+ * Every bank number is resolved once in tables, a switch only picks a
+ * pointer.
+ */
+class MBC5 : public MBC {
+    size_t rom_mbc_count;
+    size_t ram_mbc_count;
+
+    bool ram_enabled;
+
+    uint16_t rom_bank_select;
+    uint8_t ram_bank_select;
+
+    // By bank number, missing banks mirror existing ones
+    const uint8_t *rom_banks[MBC5_ROM_BANK_COUNT];
+    uint8_t *ram_banks[MBC5_RAM_BANK_COUNT];
+
+    bool map_banks();
+
+public:
+    MBC5(size_t rom_mbc_count, uint8_t ram_type);
+    ~MBC5();
+
+    void init();
+    uint8_t get(uint16_t address);
+    bool set(uint16_t address, uint8_t value);
+    bool load(const uint8_t *rom, size_t bank_count);
+
+    void serialize(std::ofstream &file);
+    void deserialize(std::ifstream &file);
+};
+
+#endif /* MBC5_H */
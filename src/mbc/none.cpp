@@ -1,28 +1,33 @@
 #include "none.h"
 
-#include <string.h>
-
 #include "../defines.h"
 #include "../log.h"
 
 
+// Read until a ROM is loaded
+static const uint8_t blank_rom[ROM_SIZE] = {};
+
+
 NoMBC::NoMBC()
 {
-    ram_size = 0;
+    memory = blank_rom;
+
+    map_banks();
 }
 
 
 NoMBC::~NoMBC()
 {
-    delete[] memory;
     delete[] ram;
 }
 
 
 void NoMBC::init()
 {
-    memory = new uint8_t[ROM_SIZE];
+    delete[] ram;
     ram = new uint8_t[RAM_MBC_SIZE];
+
+    map_banks();
 }
 
 
@@ -38,27 +43,54 @@ uint8_t NoMBC::get(uint16_t address)
 }
 
 
-bool NoMBC::load(size_t mb_index, const uint8_t *rom)
+/**
+ * @brief      Both banks are read straight from the ROM image
+ * @param[in]  rom         The ROM image
+ * @param[in]  bank_count  How many 16k banks it holds, extra ones are unused
+ * @return     true if loaded with success
+ */
+bool NoMBC::load(const uint8_t *rom, size_t bank_count)
 {
-    memcpy(memory + (MBC_SIZE * mb_index), rom, MBC_SIZE);
+    if (bank_count < ROM_SIZE / MBC_SIZE) {
+        error("ROM only cartridge needs %d memory banks\n", ROM_SIZE / MBC_SIZE);
+        return false;
+    }
+
+    memory = rom;
+
+    map_banks();
 
     return true;
 }
 
 
+/**
+ * @brief      Nothing to switch, banks only change with the ROM
+ */
+void NoMBC::map_banks()
+{
+    rom0_bank = memory;
+    rom1_bank = memory + MBC_SIZE;
+    ram_bank = ram;
+}
+
+
+/**
+ * @brief      Only RAM can be written
+ * @return     false: there are no banks to switch
+ */
 bool NoMBC::set(uint16_t address, uint8_t value)
 {
     if (address >= SRAM_START && address <= SRAM_END) {
         ram[address] = value;
     }
 
-    return true;
+    return false;
 }
 
 
 void NoMBC::serialize(std::ofstream &file)
 {
-    file.write(reinterpret_cast<char*>(memory), sizeof(uint8_t) * ROM_SIZE);
     file.write(reinterpret_cast<char*>(ram), sizeof(uint8_t) * RAM_MBC_SIZE);
 }
 
@@ -67,6 +99,5 @@ void NoMBC::deserialize(std::ifstream &file)
 {
     init();
 
-    file.read(reinterpret_cast<char*>(memory), sizeof(uint8_t) * ROM_SIZE);
     file.read(reinterpret_cast<char*>(ram), sizeof(uint8_t) * RAM_MBC_SIZE);
 }
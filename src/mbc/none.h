@@ -5,6 +5,8 @@
 
 
 class NoMBC : public MBC {
+    void map_banks();
+
 public:
     NoMBC();
     ~NoMBC();
@@ -12,7 +14,7 @@ public:
     void init();
     uint8_t get(uint16_t address);
     bool set(uint16_t address, uint8_t value);
-    bool load(size_t mb_index, const uint8_t *rom);
+    bool load(const uint8_t *rom, size_t bank_count);
 
     void serialize(std::ofstream &file);
     void deserialize(std::ifstream &file);
@@ -9,12 +9,97 @@
 #include "timer.h"
 #include "input.h"
 #include "apu.h"
-#include "gui/debugger.h"
-
-
-MMU::MMU() : ppu(nullptr), timer(nullptr), input(nullptr), apu(nullptr), debugger(nullptr)
+#include "watcher.h"
+
+
+// Unused bits of I/O registers, always read/set to 1
+static const uint8_t io_masks[IO_SIZE] = {
+//  x0    x1    x2    x3    x4    x5    x6    x7    x8    x9    xA    xB    xC    xD    xE    xF
+    0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, // FF0x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF1x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF2x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF3x
+    0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF4x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF5x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF6x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF7x
+};
+
+// Bits of I/O registers always read as 1 (unused or write only)
+static const uint8_t io_read_masks[IO_SIZE] = {
+//  x0    x1    x2    x3    x4    x5    x6    x7    x8    x9    xA    xB    xC    xD    xE    xF
+    0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, // FF0x
+    0x80, 0x3F, 0x00, 0xFF, 0xBF, 0xFF, 0x3F, 0x00, 0xFF, 0xBF, 0x7F, 0xFF, 0x9F, 0xFF, 0xBF, 0xFF, // FF1x
+    0xFF, 0x00, 0x00, 0xBF, 0x00, 0x00, 0x70, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // FF2x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF3x
+    0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF4x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF5x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF6x
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // FF7x
+};
+
+
+MMU::MMU() : ppu(nullptr), timer(nullptr), input(nullptr), apu(nullptr), watcher(nullptr), code_version(0)
 {
     cart = new Cartridge();
+
+    booted = false;
+    map_pages();
+
+    for (size_t i=0; i<IO_SIZE; i++) {
+        io_handlers[i] = nullptr;
+    }
+
+    // BOOT Status
+    io_handlers[BOOT_ROM_ENABLE - IO_START] = [](MMU *mmu, uint8_t value) { mmu->set_boot_rom_enable(value); };
+
+    // Joypad lines selection
+    io_handlers[JOYPAD - IO_START] = [](MMU *mmu, uint8_t) { mmu->input->update(); };
+
+    // LCD Control and palettes
+    io_handlers[LCDC - IO_START] = [](MMU *mmu, uint8_t value) { mmu->ppu->set_lcdc(value); };
+    io_handlers[BGP - IO_START] = [](MMU *mmu, uint8_t value) { mmu->ppu->set_bgp(value); };
+    io_handlers[OBP0 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->ppu->set_obp(0, value); };
+    io_handlers[OBP1 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->ppu->set_obp(1, value); };
+
+    // Timer
+    io_handlers[DIV - IO_START] = [](MMU *mmu, uint8_t value) { mmu->timer->set_DIV(value); };
+    io_handlers[TAC - IO_START] = [](MMU *mmu, uint8_t value) { mmu->timer->set_TAC(value); };
+    io_handlers[TIMA - IO_START] = [](MMU *mmu, uint8_t value) { mmu->timer->set_TIMA(value); };
+
+    // OAM transfer
+    io_handlers[OAM_TRANSFER - IO_START] = [](MMU *mmu, uint8_t value) { mmu->oam_transfer(value); };
+
+    // Sound - Channel 1
+    io_handlers[NR10 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR10(value); };
+    io_handlers[NR11 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR11(value); };
+    io_handlers[NR12 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR12(value); };
+    io_handlers[NR13 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR13(value); };
+    io_handlers[NR14 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR14(value); };
+
+    // Sound - Channel 2
+    io_handlers[NR21 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR21(value); };
+    io_handlers[NR22 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR22(value); };
+    io_handlers[NR23 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR23(value); };
+    io_handlers[NR24 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR24(value); };
+
+    // Sound - Channel 3
+    io_handlers[NR30 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR30(value); };
+    io_handlers[NR31 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR31(value); };
+    io_handlers[NR32 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR32(value); };
+    io_handlers[NR33 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR33(value); };
+    io_handlers[NR34 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR34(value); };
+
+    // Sound - Channel 4
+    io_handlers[NR41 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR41(value); };
+    io_handlers[NR42 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR42(value); };
+    io_handlers[NR43 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR43(value); };
+    io_handlers[NR44 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR44(value); };
+
+    // Sound Control
+    io_handlers[NR50 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR50(value); };
+    io_handlers[NR51 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR51(value); };
+    io_handlers[NR52 - IO_START] = [](MMU *mmu, uint8_t value) { mmu->apu->set_NR52(value); };
 }
 
 
@@ -59,6 +144,11 @@ bool MMU::init(std::string boot_path, std::string rom_path)
 void MMU::reset()
 {
     booted = no_boot;
+    map_pages();
+
+    if (cart->mbc != nullptr) {
+        cart->mbc->reset_clock();
+    }
 
     set(0x0100, 0x00);     // Reset MBC
 
@@ -121,6 +211,93 @@ address_type MMU::get_address_identity(uint16_t address)
 }
 
 
+/**
+ * @brief      Fills the page tables used for direct memory accesses
+ */
+void MMU::map_pages()
+{
+    code_version++;
+
+    for (size_t page=0; page<MMU_PAGE_COUNT; page++) {
+        uint16_t address = page << MMU_PAGE_SHIFT;
+
+        read_pages[page] = nullptr;
+        write_pages[page] = nullptr;
+
+        switch(get_address_identity(address)) {
+        // Tile data writes let the PPU know its decoded tiles are outdated
+        case VRAM:
+            read_pages[page] = ram + address;
+            if (address > TILE_DATA_END) {
+                write_pages[page] = ram + address;
+            }
+            break;
+        case WRAM0:
+        case WRAM1:
+            read_pages[page] = ram + address;
+            write_pages[page] = ram + address;
+            break;
+        case ECHO:
+            read_pages[page] = ram + address - 0x2000;
+            write_pages[page] = ram + address - 0x2000;
+            break;
+        // Writes have checks or callbacks for those
+        case OAM:
+        case IO_RAM:
+            read_pages[page] = ram + address;
+            break;
+        default:
+            break;
+        }
+    }
+
+    map_cartridge();
+}
+
+
+/**
+ * @brief      Update pages of the cartridge areas, called when banks changes
+ */
+void MMU::map_cartridge()
+{
+    MBC *mbc = cart->mbc;
+    if (mbc == nullptr) {
+        return;
+    }
+
+    // Banks not mapped yet are read through the cartridge
+    const uint8_t *rom0 = mbc->get_rom0_bank();
+    const uint8_t *rom1 = mbc->get_rom1_bank();
+    for (size_t offset=0; offset<MBC_SIZE; offset+=MMU_PAGE_SIZE) {
+        read_pages[(ROM0_START + offset) >> MMU_PAGE_SHIFT] = rom0 ? rom0 + offset : nullptr;
+        read_pages[(ROM1_START + offset) >> MMU_PAGE_SHIFT] = rom1 ? rom1 + offset : nullptr;
+    }
+
+    // BOOT rom is in RAM
+    if (!booted) {
+        read_pages[BOOT_START >> MMU_PAGE_SHIFT] = ram + BOOT_START;
+    }
+
+    // Cartridge without RAM let us use ours
+    uint8_t *sram = ram + SRAM_START;
+    if (cart->has_ram()) {
+        sram = mbc->get_ram_bank();
+    }
+
+    for (size_t offset=0; offset<RAM_MBC_SIZE; offset+=MMU_PAGE_SIZE) {
+        size_t page = (SRAM_START + offset) >> MMU_PAGE_SHIFT;
+
+        if (sram == nullptr) {
+            read_pages[page] = nullptr;
+            write_pages[page] = nullptr;
+        } else {
+            read_pages[page] = sram + offset;
+            write_pages[page] = sram + offset;
+        }
+    }
+}
+
+
 const char *MMU::display_address_identity(uint16_t address)
 {
     address_type type = get_address_identity(address);
@@ -152,6 +329,13 @@ const char *MMU::display_address_identity(uint16_t address)
  */
 bool MMU::set(uint16_t address, uint8_t value)
 {
+    // Plain memory: no checks nor callbacks (breakpoints need the full path)
+    uint8_t *page = write_pages[address >> MMU_PAGE_SHIFT];
+    if (page != nullptr && (watcher == nullptr || !watcher->breakpoint_activated)) {
+        page[address & (MMU_PAGE_SIZE - 1)] = value;
+        return false;
+    }
+
     address_type identity = get_address_identity(address);
 
     // Cannot write over BOOT rom
@@ -161,7 +345,9 @@ bool MMU::set(uint16_t address, uint8_t value)
 
     // Write to ROM are passed to cartridge
     else if (identity == ROM0 || identity == ROM1) {
-        cart->set(address, value);
+        if (cart->set(address, value)) {
+            map_cartridge();
+        }
         return true;
     }
 
@@ -181,6 +367,24 @@ bool MMU::set(uint16_t address, uint8_t value)
         address -= 0x2000;
     }
 
+    else if (identity == IO_RAM) {
+        return set_io(address, value);
+    }
+
+    set_nocheck(address, value);
+
+    return false;
+}
+
+
+/**
+ * @brief      Set the value of an I/O register and let the hardware know
+ * @param[in]  address  The address
+ * @param[in]  value    The value to write
+ * @return     false
+ */
+bool MMU::set_io(uint16_t address, uint8_t value)
+{
     // LCD_STATUS
     if (address == LCD_STATUS) {
         // Cannot overwrite on Mode and coincidence flag
@@ -188,7 +392,7 @@ bool MMU::set(uint16_t address, uint8_t value)
     }
 
     // Sound Control
-    if (address >= NR10 && address <= NR51 && !apu->is_power_on()) {
+    else if (address >= NR10 && address <= NR51 && !apu->is_power_on()) {
         // Cannot write while off except for length
         if (address == NR31) {
             // Don't block those write
@@ -201,15 +405,30 @@ bool MMU::set(uint16_t address, uint8_t value)
         }
     }
 
-    if (address == NR52) {
+    else if (address == NR52) {
         value &= 0xF0;
     }
 
-    value = memory_masks(address, value);
+    size_t index = address - IO_START;
+
+    value |= io_masks[index];
+
+    // Sound produced until now must not be affected by the new value
+    if (address >= NR10 && address <= SOUND_WAVE_REG_STOP) {
+        apu->catch_up();
+    }
+
+    // Neither the counting done until now
+    else if (address >= DIV && address <= TAC) {
+        timer->catch_up();
+    }
 
     set_nocheck(address, value);
 
-    handle_callbacks(address, value);
+    io_handler handler = io_handlers[index];
+    if (handler != nullptr) {
+        handler(this, value);
+    }
 
     return false;
 }
@@ -227,8 +446,16 @@ void MMU::set_nocheck(uint16_t address, uint8_t value)
 {
     ram[address] = value;
 
-    if (debugger != nullptr && debugger->breakpoint_activated) {
-        debugger->feed_memory_write(address);
+    if (ppu != nullptr) {
+        if (address >= VRAM_START && address <= TILE_DATA_END) {
+            ppu->invalidate_tile(address);
+        } else if (address >= OAM_START && address <= OAM_END) {
+            ppu->invalidate_sprites();
+        }
+    }
+
+    if (watcher != nullptr && watcher->breakpoint_activated) {
+        watcher->feed_memory_write(address);
     }
 }
 
@@ -241,24 +468,16 @@ uint8_t MMU::get(uint16_t address)
 
 uint8_t MMU::_get(uint16_t address, bool feed_read)
 {
-    uint8_t value = _get_nocheck(address, feed_read);
-
-    // Sound
-    if (address >= NR10 && address <= NR52) {
-        const uint8_t sound_masks[] = {
-            0x80, 0x3F, 0x00, 0xFF, 0xBF,
-            0xFF, 0x3F, 0x00, 0xFF, 0xBF,
-            0x7F, 0xFF, 0x9F, 0xFF, 0xBF,
-            0xFF, 0xFF, 0x00, 0x00, 0xBF,
-            0x00, 0x00, 0x70
-        };
+    if (address < IO_START || address > IO_END) {
+        return _get_nocheck(address, feed_read);
+    }
 
-        value |= sound_masks[address - NR10];
-    } else if (address >= FF_START && address <= FF_END) {
-        value = 0xFF;
+    // Timer counters are only computed when needed
+    if (address == DIV || address == TIMA) {
+        timer->catch_up();
     }
 
-    return memory_masks(address, value);
+    return _get_nocheck(address, feed_read) | io_read_masks[address - IO_START];
 }
 
 
@@ -284,11 +503,16 @@ uint8_t MMU::_get_nocheck(uint16_t address, bool feed_read)
     uint8_t value;
 
     if (feed_read) {
-        if (debugger != nullptr && debugger->breakpoint_activated) {
-            debugger->feed_memory_read(address);
+        if (watcher != nullptr && watcher->breakpoint_activated) {
+            watcher->feed_memory_read(address);
         }
     }
 
+    const uint8_t *page = read_pages[address >> MMU_PAGE_SHIFT];
+    if (page != nullptr) {
+        return page[address & (MMU_PAGE_SIZE - 1)];
+    }
+
     address_type identity = get_address_identity(address);
 
     // ECHO memory
@@ -310,150 +534,65 @@ uint8_t MMU::_get_nocheck(uint16_t address, bool feed_read)
 
 
 /**
- * @brief      Apply mask on some values Example: unused bits of IF should
- *             always read/set to 1
- * @param[in]  address  The address
- * @param[in]  value    The value
- * @return     value
+ * @brief      Copy sprites attributes to OAM
+ * @param[in]  value  Source address divided by 0x100
  */
-uint8_t MMU::memory_masks(uint16_t address, uint8_t value)
+void MMU::oam_transfer(uint8_t value)
 {
-
-    // LCD_STATUS
-    if (address == LCD_STATUS) {
-        // Last bit unused
-        value |= 0b10000000;
+    for (uint16_t i=0; i<OAM_SIZE; i++) {
+        set_nocheck(OAM_START + i, get_nocheck((value * 0x0100) + i));
     }
+}
 
-    // Joypad
-    else if (address == JOYPAD) {
-        // Last two bytes always 1
-        value |= 0b11000000;
-    }
 
-    // Interrupts
-    else if (address == IF_ADDRESS) {
-        // Last three bit always set
-        value |= 0xE0;
-    }
+uint16_t MMU::get16(uint16_t address)
+{
+    uint16_t low = (uint16_t)get(address);
+    uint16_t high = (uint16_t)get(address + 1);
 
-    return value;
+    return (high << 8) + low;
+}
+
+
+int8_t MMU::get_signed(uint16_t address)
+{
+    return get(address);
 }
 
 
 /**
- * @brief      Check function that should be called on RAM modification
+ * @brief      Gives direct access to cartridge ROM for the CPU to decode
+ *
+ * Returned pointer identifies the bank the address currently maps to
  * @param[in]  address  The address
- * @param[in]  value    The value
+ * @return     nullptr outside cartridge ROM or when reads are watched
  */
-void MMU::handle_callbacks(uint16_t address, uint8_t value)
+const uint8_t *MMU::get_code(uint16_t address)
 {
-    // BOOT Status
-    if (address == BOOT_ROM_ENABLE) {
-        set_boot_rom_enable(value);
-    }
-
-    // LCD Control
-    else if (address == LCDC) {
-        ppu->set_lcdc(value);
-    }
-
-    // BG Palette
-    else if (address == BGP) {
-        ppu->set_bgp(value);
-    } else if (address == OBP0) {
-        ppu->set_obp(0, value);
-    } else if (address == OBP1) {
-        ppu->set_obp(1, value);
-    }
-
-    // Timer
-    else if (address == DIV) {
-        timer->set_DIV(value);
-    } else if (address == TAC) {
-        timer->set_TAC(value);
-    } else if (address == TIMA) {
-        timer->set_TIMA(value);
-    }
-
-    // OAM transfer
-    else if (address == OAM_TRANSFER) {
-        for (uint16_t i=0; i<OAM_SIZE; i++) {
-            set_nocheck(OAM_START + i, get_nocheck((value * 0x0100) + i));
-        }
-    }
-
-    // Sound - Channel 1
-    else if (address == NR10) {
-        apu->set_NR10(value);
-    } else if (address == NR11) {
-        apu->set_NR11(value);
-    } else if (address == NR12) {
-        apu->set_NR12(value);
-    } else if (address == NR13) {
-        apu->set_NR13(value);
-    } else if (address == NR14) {
-        apu->set_NR14(value);
-    }
-
-    // Sound - Channel 2
-    else if (address == NR21) {
-        apu->set_NR21(value);
-    } else if (address == NR22) {
-        apu->set_NR22(value);
-    } else if (address == NR23) {
-        apu->set_NR23(value);
-    } else if (address == NR24) {
-        apu->set_NR24(value);
+    if (address > ROM1_END || (!booted && address <= BOOT_END)) {
+        return nullptr;
     }
 
-    // Sound - Channel 3
-    else if (address == NR30) {
-        apu->set_NR30(value);
-    } else if (address == NR31) {
-        apu->set_NR31(value);
-    } else if (address == NR32) {
-        apu->set_NR32(value);
-    } else if (address == NR33) {
-        apu->set_NR33(value);
-    } else if (address == NR34) {
-        apu->set_NR34(value);
+    if (watcher != nullptr && watcher->breakpoint_activated) {
+        return nullptr;
     }
 
-    // Sound - Channel 4
-    else if (address == NR41) {
-        apu->set_NR41(value);
-    } else if (address == NR42) {
-        apu->set_NR42(value);
-    } else if (address == NR43) {
-        apu->set_NR43(value);
-    } else if (address == NR44) {
-        apu->set_NR44(value);
-    }
-
-    // Sound Control
-    else if (address == NR50) {
-        apu->set_NR50(value);
-    } else if (address == NR51) {
-        apu->set_NR51(value);
-    } else if (address == NR52) {
-        apu->set_NR52(value);
+    const uint8_t *page = read_pages[address >> MMU_PAGE_SHIFT];
+    if (page == nullptr) {
+        return nullptr;
     }
-}
-
-
-uint16_t MMU::get16(uint16_t address)
-{
-    uint16_t low = (uint16_t)get(address);
-    uint16_t high = (uint16_t)get(address + 1);
 
-    return (high << 8) + low;
+    return page + (address & (MMU_PAGE_SIZE - 1));
 }
 
 
-int8_t MMU::get_signed(uint16_t address)
+/**
+ * @brief      Pointers given by get_code are valid as long as this is unchanged
+ * @return     The code version
+ */
+size_t MMU::get_code_version()
 {
-    return get(address);
+    return code_version;
 }
 
 
@@ -464,11 +603,12 @@ int8_t MMU::get_signed(uint16_t address)
  */
 bool MMU::load_rom(std::string filepath)
 {
-    if (!cart->load(filepath)) {
-        return false;
-    }
+    bool success = cart->load(filepath);
 
-    return true;
+    // Cartridge may have been replaced even on failure
+    map_pages();
+
+    return success;
 }
 
 
@@ -565,6 +705,8 @@ void MMU::trigger_interrupt(uint8_t interrupt_mask)
 void MMU::set_booted(bool value)
 {
     booted = value;
+
+    map_cartridge();
 }
 
 
@@ -580,6 +722,24 @@ void MMU::set_ppu(PPU *ppu)
 }
 
 
+/**
+ * @brief      Gives the cartridge a clock to follow
+ * @param      dmg   The DMG
+ */
+void MMU::set_dmg(DMG *dmg)
+{
+    cart->set_dmg(dmg);
+}
+
+
+void MMU::adjust_clocks(size_t adjustment)
+{
+    if (cart->mbc != nullptr) {
+        cart->mbc->adjust_clocks(adjustment);
+    }
+}
+
+
 void MMU::set_timer(Timer *timer)
 {
     this->timer = timer;
@@ -598,9 +758,9 @@ void MMU::set_apu(APU *apu)
 }
 
 
-void MMU::set_debugger(Debugger *debugger)
+void MMU::set_watcher(Watcher *watcher)
 {
-    this->debugger = debugger;
+    this->watcher = watcher;
 }
 
 
@@ -623,4 +783,6 @@ void MMU::deserialize(std::ifstream &file)
     file.read(reinterpret_cast<char*>(ram), sizeof(uint8_t) * RAM_SIZE);
 
     cart->deserialize(file);
+
+    map_pages();
 }
@@ -9,11 +9,17 @@
 #include "cartridge.h"
 
 
+class DMG;
 class PPU;
 class Timer;
 class Input;
 class APU;
-class Debugger;
+class Watcher;
+class MMU;
+
+
+// Called when an I/O register is written
+typedef void (*io_handler)(MMU *mmu, uint8_t value);
 
 
 /**
@@ -25,16 +31,29 @@ class MMU {
     Timer *timer;
     Input *input;
     APU *apu;
-    Debugger *debugger;
+    Watcher *watcher;
 
     bool booted;
     uint8_t boot[BOOT_SIZE];
     uint8_t ram[RAM_SIZE];
 
+    // Direct access to memory, nullptr pages go through get_address_identity
+    const uint8_t *read_pages[MMU_PAGE_COUNT];
+    uint8_t *write_pages[MMU_PAGE_COUNT];
+
+    // Incremented when the whole mapping is rebuilt (new ROM, state loaded)
+    size_t code_version;
+
     address_type get_address_identity(uint16_t address);
 
-    uint8_t memory_masks(uint16_t address, uint8_t value);
-    void handle_callbacks(uint16_t address, uint8_t value);
+    void map_pages();
+    void map_cartridge();
+
+    // Indexed by I/O register, nullptr when nothing to do
+    io_handler io_handlers[IO_SIZE];
+
+    bool set_io(uint16_t address, uint8_t value);
+    void oam_transfer(uint8_t value);
 
 public:
     bool no_boot;           // No boot rom provided
@@ -54,6 +73,9 @@ public:
     uint16_t get16(uint16_t address);
     int8_t get_signed(uint16_t address);
 
+    const uint8_t *get_code(uint16_t address);
+    size_t get_code_version();
+
     bool load_boot(std::string filepath);
     bool load_rom(std::string filepath);
     bool load(uint8_t *program, size_t size, uint16_t dst);
@@ -66,13 +88,16 @@ public:
 
     void trigger_interrupt(uint8_t interrupt_mask);
 
+    void adjust_clocks(size_t adjustment);
+
     const char *display_address_identity(uint16_t address);
 
+    void set_dmg(DMG *dmg);
     void set_ppu(PPU *ppu);
     void set_timer(Timer *timer);
     void set_input(Input *input);
     void set_apu(APU *apu);
-    void set_debugger(Debugger *debugger);
+    void set_watcher(Watcher *watcher);
 
     void serialize(std::ofstream &file);
     void deserialize(std::ifstream &file);
@@ -1,20 +1,16 @@
 #include "ppu.h"
 
-#include "dmg.h"
+#include <string.h>
+
 #include "log.h"
 #include "utils.h"
 
 
-PPU::PPU() : mmu(nullptr)
-{
-    sdl_screen = nullptr;
-    sdl_window = nullptr;
-}
-
-
-PPU::~PPU()
+PPU::PPU() :
+    mmu(nullptr), video(nullptr), sprite_height(8), renderer(RENDERER_SCANLINE), render_interval(1),
+    displayable_sprites_count(0), sprite_binning(true), sprite_bins_dirty(true)
 {
-    quit();
+    invalidate_tiles();
 }
 
 
@@ -29,29 +25,6 @@ bool PPU::init()
         return false;
     }
 
-    quit();
-
-    sdl_window = SDL_CreateWindow(
-        "DMG - Emulator",
-        SDL_WINDOWPOS_UNDEFINED,
-        SDL_WINDOWPOS_UNDEFINED,
-        SCREEN_WIDTH,
-        SCREEN_HEIGHT,
-        SDL_WINDOW_SHOWN
-    );
-    if(sdl_window == NULL) {
-        error("Unable to create a display window\n");
-        return false;
-    }
-
-    sdl_screen = SDL_GetWindowSurface(sdl_window);
-    if (sdl_screen == nullptr) {
-        error("Unable to get the screen surface\n");
-        return false;
-    }
-
-    pixel_format = sdl_screen->format;
-
     set_palette(0);
 
     return true;
@@ -69,8 +42,16 @@ void PPU::reset()
     background_enabled = false;
 
     clock = 0;
+    frame_count = 0;
 
     current_ly = 0xFF;
+
+    memset(framebuffer, SHADE_LCD_DISABLED, sizeof(framebuffer));
+
+    displayable_sprites_count = 0;
+
+    invalidate_tiles();
+    invalidate_sprites();
 }
 
 
@@ -102,9 +83,14 @@ void PPU::step()
 
     // Draw (0 - 143)
     if (ly < LINE_Y_COUNT) {
+        // Skipped frames keep the exact same timings
+        bool rendered = is_frame_rendered();
+
         if (current_mode == H_BLANK ||
             current_mode == V_BLANK) {
-            oam_search(ly);
+            if (rendered) {
+                oam_search(ly);
+            }
 
             current_mode = OAM_SEARCH;
             update_lcd_status();
@@ -113,7 +99,13 @@ void PPU::step()
 
         // Pixel transfer
         else if (current_mode == OAM_SEARCH) {
-            pixel_transfer(ly);
+            if (!rendered) {
+                // Nothing to draw
+            } else if (renderer == RENDERER_FIFO) {
+                pixel_transfer(ly);
+            } else {
+                render_line(ly);
+            }
 
             current_mode = PIXEL_TRANSFER;
             update_lcd_status();
@@ -137,7 +129,12 @@ void PPU::step()
                 mmu->trigger_interrupt(INT_V_BLANK_MASK);
             }
 
-            SDL_UpdateWindowSurface(sdl_window);
+            if (video != nullptr && is_frame_rendered()) {
+                output_frame();
+                video->present();
+            }
+
+            frame_count++;
         }
 
         current_mode = V_BLANK;
@@ -147,18 +144,13 @@ void PPU::step()
 }
 
 
-void PPU::quit()
+/**
+ * @brief      Tells if the current frame is drawn or skipped
+ * @return     true when drawn
+ */
+bool PPU::is_frame_rendered()
 {
-    if (sdl_screen) {
-        SDL_FreeSurface(sdl_screen);
-    }
-
-    if (sdl_window) {
-        SDL_DestroyWindow(sdl_window);
-    }
-
-    sdl_screen = nullptr;
-    sdl_window = nullptr;
+    return render_interval != RENDER_NEVER && frame_count % render_interval == 0;
 }
 
 
@@ -168,24 +160,92 @@ void PPU::quit()
  */
 void PPU::oam_search(uint8_t ly)
 {
-    displayable_sprites.clear();
+    displayable_sprites_count = 0;
 
-    for (size_t oam_id=0; oam_id < OAM_COUNT && displayable_sprites.size() < MAX_SPRITE_DISPLAYED; oam_id++) {
+    if (sprite_binning) {
+        if (sprite_bins_dirty) {
+            bin_sprites();
+        }
+
+        for (size_t i=0; i<sprite_bins_count[ly]; i++) {
+            add_displayable_sprite(sprite_bins[ly][i]);
+        }
+
+        return;
+    }
+
+    for (size_t oam_id=0; oam_id < OAM_COUNT && displayable_sprites_count < MAX_SPRITE_DISPLAYED; oam_id++) {
         uint16_t oam_address = OAM_START + (oam_id * OAM_ENTRY_SIZE);
 
-        Sprite sprite;
-        sprite.y = mmu->get_nocheck(oam_address);
-        sprite.x = mmu->get_nocheck(oam_address + 1);
+        uint8_t y = mmu->get_nocheck(oam_address);
+        uint8_t x = mmu->get_nocheck(oam_address + 1);
+
+        if (x != 0 &&
+            y + (uint8_t)sprite_height > ly + SPRITE_Y_OFFSET &&
+            ly + SPRITE_Y_OFFSET >= y) {
+            add_displayable_sprite(oam_id);
+        }
+    }
+}
+
+
+/**
+ * @brief      Does the OAM search of all lines at once
+ * Same results as oam_search, kept until OAM or sprite height changes
+ */
+void PPU::bin_sprites()
+{
+    for (size_t ly=0; ly<LINE_Y_COUNT; ly++) {
+        sprite_bins_count[ly] = 0;
+    }
+
+    for (size_t oam_id=0; oam_id<OAM_COUNT; oam_id++) {
+        uint16_t oam_address = OAM_START + (oam_id * OAM_ENTRY_SIZE);
 
-        if (sprite.x != 0 &&
-            sprite.y + (uint8_t)sprite_height > ly + SPRITE_Y_OFFSET &&
-            ly + SPRITE_Y_OFFSET >= sprite.y) {
-            sprite.tile = mmu->get_nocheck(oam_address + 2);
-            sprite.attrs = mmu->get_nocheck(oam_address + 3);
+        uint8_t y = mmu->get_nocheck(oam_address);
+        uint8_t x = mmu->get_nocheck(oam_address + 1);
 
-            displayable_sprites.push_back(sprite);
+        if (x == 0) {
+            continue;
         }
+
+        // Lines covered by the sprite
+        int first_ly = y - SPRITE_Y_OFFSET;
+        int end_ly = first_ly + sprite_height;
+
+        for (int ly=(first_ly < 0 ? 0 : first_ly); ly<end_ly && ly<LINE_Y_COUNT; ly++) {
+            if (sprite_bins_count[ly] < MAX_SPRITE_DISPLAYED) {
+                sprite_bins[ly][sprite_bins_count[ly]++] = oam_id;
+            }
+        }
+    }
+
+    sprite_bins_dirty = false;
+}
+
+
+/**
+ * @brief      Adds a sprite to the ones displayed on the line, sorted by X
+ * @param[in]  oam_id  The OAM entry of the sprite
+ */
+void PPU::add_displayable_sprite(size_t oam_id)
+{
+    uint16_t oam_address = OAM_START + (oam_id * OAM_ENTRY_SIZE);
+
+    Sprite sprite;
+    sprite.y = mmu->get_nocheck(oam_address);
+    sprite.x = mmu->get_nocheck(oam_address + 1);
+    sprite.tile = mmu->get_nocheck(oam_address + 2);
+    sprite.attrs = mmu->get_nocheck(oam_address + 3);
+
+    // Sprites with the same X stay in OAM order
+    size_t i = displayable_sprites_count++;
+    while (i > 0 && displayable_sprites[i - 1].x > sprite.x) {
+        displayable_sprites[i] = displayable_sprites[i - 1];
+        i--;
     }
+
+    displayable_sprites[i] = sprite;
 }
 
 
@@ -197,6 +257,8 @@ void PPU::pixel_transfer(uint8_t ly)
     clear_fifo();
     pixel_type fetching_type = BG;
 
+    uint8_t *line = framebuffer[ly];
+
     // Viewport position
     //uint8_t scy = mmu->get(SCY);
     uint8_t scx = mmu->get(SCX);
@@ -210,6 +272,8 @@ void PPU::pixel_transfer(uint8_t ly)
         pop_pixel();
     }
 
+    size_t next_sprite = 0;
+
     for (size_t x=0; x<LINE_X_COUNT; x++) {
         // We want to draw the window
         uint8_t wy = mmu->get_nocheck(WY);
@@ -224,23 +288,30 @@ void PPU::pixel_transfer(uint8_t ly)
             fetch(x, ly, fetching_type);
         }
 
-        // Fetch sprites
-        if (sprites_enabled) {
-            for (auto const& sprite : displayable_sprites) {
-                uint8_t sprite_x_corrected = sprite.x - SPRITE_X_OFFSET;
-                if (sprite_x_corrected == x) {
-                    fetch_sprite(sprite, ly, TILE_WIDTH);
-                }
-                // Pixel partially hidden on the left
-                else if (x == 0 && sprite.x < SPRITE_X_OFFSET) {
-                    fetch_sprite(sprite, ly, sprite.x);
+        // Fetch sprites, they come sorted by X
+        while (sprites_enabled && next_sprite < displayable_sprites_count) {
+            const Sprite &sprite = displayable_sprites[next_sprite];
+
+            // Pixel partially hidden on the left
+            if (sprite.x < SPRITE_X_OFFSET) {
+                if (x != 0) {
+                    break;
                 }
+                fetch_sprite(sprite, ly, sprite.x);
             }
+            else if ((size_t)(sprite.x - SPRITE_X_OFFSET) == x) {
+                fetch_sprite(sprite, ly, TILE_WIDTH);
+            }
+            else {
+                break;
+            }
+
+            next_sprite++;
         }
 
         Pixel pixel = pop_pixel();
 
-        Uint32 color = color_lcd_disabled;
+        uint8_t shade = SHADE_LCD_DISABLED;
 
         // Don't color anything if LCD is disabled
         if (lcd_enabled) {
@@ -252,10 +323,241 @@ void PPU::pixel_transfer(uint8_t ly)
                 used_palette = sprite_palette[1];
             }
 
-            color = palette[used_palette[pixel.value]];
+            shade = used_palette[pixel.value];
+        }
+
+        line[x] = shade;
+    }
+}
+
+
+/**
+ * @brief      Draws a whole line at once, from BG to sprites
+ * Gives the same picture as pixel_transfer, window start included
+ * @param[in]  ly    Line to draw
+ */
+void PPU::render_line(uint8_t ly)
+{
+    uint8_t *line = framebuffer[ly];
+
+    // Don't color anything if LCD is disabled
+    if (!lcd_enabled) {
+        memset(line, SHADE_LCD_DISABLED, LINE_X_COUNT);
+        return;
+    }
+
+    uint8_t scx = mmu->get_nocheck(SCX);
+    uint8_t scy = mmu->get_nocheck(SCY);
+    uint8_t wy = mmu->get_nocheck(WY);
+
+    // First column of the window, LINE_X_COUNT when not displayed
+    size_t window_x = LINE_X_COUNT;
+    if (window_enabled && ly >= wy && get_wx() < LINE_X_COUNT) {
+        window_x = get_wx();
+    }
+
+    render_map(bg_map_address, scx, (scy + ly) % (MAP_HEIGHT * TILE_HEIGHT), 0, window_x);
+
+    if (window_x < LINE_X_COUNT) {
+        render_map(window_map_address, 0, ly - wy, window_x, LINE_X_COUNT);
+    }
+
+    if (sprites_enabled) {
+        render_sprites(ly, window_x);
+    }
+
+    // BGP/OBP to apply, indexed by pixel type
+    const uint8_t *palettes[] = {
+        bg_palette, bg_palette, sprite_palette[0], sprite_palette[1]
+    };
+
+    for (size_t x=0; x<LINE_X_COUNT; x++) {
+        line[x] = palettes[line_pixels[x].type][line_pixels[x].value];
+    }
+}
+
+
+/**
+ * @brief      Draws a part of the line from a BG/window map
+ * @param[in]  map_address  Base address of the map
+ * @param[in]  map_x        Position in the map of the first pixel
+ * @param[in]  map_y        Line of the map to draw
+ * @param[in]  start        First column to draw
+ * @param[in]  end          Column after the last one to draw
+ */
+void PPU::render_map(
+    uint16_t map_address, size_t map_x, size_t map_y,
+    size_t start, size_t end)
+{
+    uint16_t map_line_address = map_address + (map_y / TILE_HEIGHT) * MAP_WIDTH;
+    size_t tile_y = map_y % TILE_HEIGHT;
+
+    const uint8_t *tile_line = nullptr;
+
+    for (size_t x=start; x<end; x++, map_x++) {
+        map_x %= MAP_WIDTH * TILE_WIDTH;
+
+        // Entering a new tile
+        if (tile_line == nullptr || map_x % TILE_WIDTH == 0) {
+            size_t tile_index = get_bg_tile_index(map_line_address + map_x / TILE_WIDTH);
+            tile_line = get_tile_line(tile_index, tile_y);
+        }
+
+        line_pixels[x].value = tile_line[map_x % TILE_WIDTH];
+        line_pixels[x].type = BG;   // Only used for palette so same as WINDOW here
+    }
+}
+
+
+/**
+ * @brief      Draws the sprites found by OAM search over the line
+ * @param[in]  ly        Line to draw
+ * @param[in]  window_x  First column of the window
+ */
+void PPU::render_sprites(uint8_t ly, size_t window_x)
+{
+    // Sorted by X so in the order the FIFO would fetch them
+    for (size_t i=0; i<displayable_sprites_count; i++) {
+        const Sprite &sprite = displayable_sprites[i];
+
+        // Columns covered by the sprite (first one can be off screen)
+        int first_x = sprite.x - SPRITE_X_OFFSET;
+        size_t end_x = sprite.x;
+        if (end_x > LINE_X_COUNT) {
+            end_x = LINE_X_COUNT;
+        }
+
+        // Column the sprite is fetched at
+        size_t fetch_x = first_x < 0 ? 0 : first_x;
+
+        // Window start flushes sprite pixels fetched before it
+        if (fetch_x < window_x && end_x > window_x) {
+            end_x = window_x;
+        }
+
+        // Line of the tile we want
+        size_t viewport_y = ly - (sprite.y - SPRITE_Y_OFFSET);
+
+        if (get_bit(sprite.attrs, BIT_SPRITE_Y_FLIP)) {
+            viewport_y = (sprite_height - 1) - viewport_y;
+        }
+
+        viewport_y %= sprite_height;
+
+        // Mask last bit when sprite height is 16, second tile follows
+        uint8_t tile = sprite.tile;
+        if (sprite_height == 16) {
+            tile &= 0xFE;
+        }
+
+        const uint8_t *tile_line = get_tile_line(
+            tile + viewport_y / TILE_HEIGHT, viewport_y % TILE_HEIGHT);
+
+        pixel_type type = SPRITE_OBP0;
+        if (get_bit(sprite.attrs, BIT_SPRITE_PALETTE_NUMBER)) {
+            type = SPRITE_OBP1;
+        }
+
+        bool sprite_on_top = !get_bit(sprite.attrs, BIT_SPRITE_PRIORITY);
+        bool x_flip = get_bit(sprite.attrs, BIT_SPRITE_X_FLIP);
+
+        for (size_t x=fetch_x; x<end_x; x++) {
+            size_t index = x - first_x;
+            uint8_t value = tile_line[x_flip ? (TILE_WIDTH - 1) - index : index];
+
+            Pixel &current_pixel = line_pixels[x];
+
+            // Sprite with lowest X is on top, 00 is transparent for sprite
+            if (current_pixel.type == SPRITE_OBP0 ||
+                current_pixel.type == SPRITE_OBP1 ||
+                value == 0) {
+                continue;
+            }
+
+            // BG 0 is always behind sprites
+            if (!sprite_on_top && current_pixel.value != 0) {
+                continue;
+            }
+
+            current_pixel.value = value;
+            current_pixel.type = type;
         }
+    }
+}
+
+
+/**
+ * @brief      Gets a line of a tile, decoding the tile if it was written
+ * @param[in]  tile_index  Index of the tile from $8000
+ * @param[in]  y           Line in the tile
+ * @return     TILE_WIDTH color indexes
+ */
+const uint8_t *PPU::get_tile_line(size_t tile_index, size_t y)
+{
+    if (tile_dirty[tile_index]) {
+        uint16_t tile_address = TILE_ADDRESS_1 + (tile_index * TILE_SIZE);
+
+        for (size_t tile_y=0; tile_y<TILE_HEIGHT; tile_y++) {
+            uint16_t line_address = tile_address + (tile_y * TILE_LINE_SIZE);
 
-        set_pixel(sdl_screen, x, ly, color);
+            uint8_t data1 = mmu->get_nocheck(line_address);
+            uint8_t data2 = mmu->get_nocheck(line_address + 1);
+
+            decode_tile_line(data1, data2, tile_cache[tile_index][tile_y]);
+        }
+
+        tile_dirty[tile_index] = false;
+    }
+
+    return tile_cache[tile_index][y];
+}
+
+
+/**
+ * @brief      Gets the tile used by BG/window at the given map address
+ * @param[in]  map_address  The map address
+ * @return     Index of the tile from $8000
+ */
+size_t PPU::get_bg_tile_index(uint16_t map_address)
+{
+    uint8_t tile_id = mmu->get_nocheck(map_address);
+    if (bg_window_tile_data_address == TILE_ADDRESS_2) {
+        // When tileset base address is $8800: tile ID are signed and 0 is $9000
+        tile_id += 128;
+    }
+
+    return (bg_window_tile_data_address - TILE_ADDRESS_1) / TILE_SIZE + tile_id;
+}
+
+
+/**
+ * @brief      Marks the tile at the given address to be decoded again
+ * Called by the MMU on writes to tile data
+ * @param[in]  address  Address in tile data [$8000, $97FF]
+ */
+void PPU::invalidate_tile(uint16_t address)
+{
+    tile_dirty[(address - TILE_ADDRESS_1) / TILE_SIZE] = true;
+}
+
+
+/**
+ * @brief      Marks the OAM search results of every line outdated
+ * Called by the MMU on writes to OAM
+ */
+void PPU::invalidate_sprites()
+{
+    sprite_bins_dirty = true;
+}
+
+
+/**
+ * @brief      Marks all tiles to be decoded again (VRAM changed as a whole)
+ */
+void PPU::invalidate_tiles()
+{
+    for (size_t i=0; i<TILE_COUNT; i++) {
+        tile_dirty[i] = true;
     }
 }
 
@@ -351,6 +653,9 @@ void PPU::fetch_sprite(const Sprite &sprite, size_t ly, size_t pixel_count)
     uint8_t data1 = mmu->get_nocheck(tile_line_address);
     uint8_t data2 = mmu->get_nocheck(tile_line_address + 1);
 
+    uint8_t values[TILE_WIDTH];
+    decode_tile_line(data1, data2, values);
+
     Pixel pixel;
 
     // Palette used
@@ -370,9 +675,9 @@ void PPU::fetch_sprite(const Sprite &sprite, size_t ly, size_t pixel_count)
         uint8_t index = (TILE_WIDTH - pixel_count) + i;
 
         if (get_bit(sprite.attrs, BIT_SPRITE_X_FLIP)) {
-            pixel.value = get_pixel_value(data1, data2, 7 - index);
+            pixel.value = values[7 - index];
         } else {
-            pixel.value = get_pixel_value(data1, data2, index);
+            pixel.value = values[index];
         }
 
         Pixel current_pixel = pixel_fifo[(pf_index + i) % FIFO_SIZE];
@@ -424,10 +729,13 @@ void PPU::fetch_at(
     uint8_t data1 = mmu->get_nocheck(tile_line_address);
     uint8_t data2 = mmu->get_nocheck(tile_line_address + 1);
 
+    uint8_t values[TILE_WIDTH];
+    decode_tile_line(data1, data2, values);
+
     // Exctract the 8 pixels for the data
     for (size_t i=0; i<TILE_WIDTH; i++) {
         Pixel pixel;
-        pixel.value = get_pixel_value(data1, data2, i);
+        pixel.value = values[i];
         pixel.type = BG;    // Only used for palette so same as WINDOW here
 
         pixel_fifo[(pf_index + pf_size++) % FIFO_SIZE] = pixel;
@@ -549,9 +857,14 @@ void PPU::set_lcdc(uint8_t lcdc)
         window_map_address = MAP_ADDRESS_2;
     }
 
-    sprite_height = 8;
+    size_t height = 8;
     if (get_bit(lcdc, BIT_SPRITES_SIZE)) {
-        sprite_height = 16;
+        height = 16;
+    }
+
+    if (height != sprite_height) {
+        sprite_height = height;
+        invalidate_sprites();
     }
 }
 
@@ -582,12 +895,6 @@ void PPU::set_obp(size_t obp_id, uint8_t value)
 }
 
 
-Uint32 PPU::get_window_id()
-{
-    return SDL_GetWindowID(sdl_window);
-}
-
-
 uint8_t PPU::get_current_ly()
 {
     return current_ly;
@@ -613,32 +920,78 @@ const char *PPU::get_current_mode()
  */
 void PPU::set_palette(size_t palette_index)
 {
-    color_lcd_disabled = SDL_MapRGB(pixel_format, 150, 125, 16);
+    const uint8_t palettes[][PALETTE_SIZE][3] = {
+        // Original values
+        { { 110, 125,  70 }, {  80, 105,  75 }, {  60,  90,  85 }, {  60,  80,  75 } },
+        // Black/White
+        { { 255, 255, 255 }, { 211, 211, 211 }, { 120, 120, 120 }, {   0,   0,   0 } },
+        // Clean green scales
+        { { 0xE0, 0xF8, 0xD0 }, { 0x88, 0xC0, 0x70 }, { 0x34, 0x68, 0x56 }, { 0x08, 0x18, 0x20 } },
+    };
+
+    if (palette_index > 2) {
+        palette_index = 0;
+    }
 
-    // Blac/White
-    if (palette_index == 1) {
-        palette[0] = SDL_MapRGB(pixel_format, 255, 255, 255);
-        palette[1] = SDL_MapRGB(pixel_format, 211, 211, 211);
-        palette[2] = SDL_MapRGB(pixel_format, 120, 120, 120);
-        palette[3] = SDL_MapRGB(pixel_format,   0,   0,   0);
+    rgb_lcd_disabled[0] = 150;
+    rgb_lcd_disabled[1] = 125;
+    rgb_lcd_disabled[2] = 16;
+
+    for (size_t i=0; i<PALETTE_SIZE; i++) {
+        for (size_t component=0; component<3; component++) {
+            rgb_palette[i][component] = palettes[palette_index][i][component];
+        }
+    }
+
+    map_colors();
+}
+
+
+/**
+ * @brief      Converts the palette colors to the video sink format
+ */
+void PPU::map_colors()
+{
+    if (video == nullptr) {
+        return;
     }
-    // Clean green scales
-    else if (palette_index == 2) {
-        palette[0] = SDL_MapRGB(pixel_format, 0xE0, 0xF8, 0xD0);
-        palette[1] = SDL_MapRGB(pixel_format, 0x88, 0xC0, 0x70);
-        palette[2] = SDL_MapRGB(pixel_format, 0x34, 0x68, 0x56);
-        palette[3] = SDL_MapRGB(pixel_format, 0x08, 0x18, 0x20);
+
+    shade_colors[SHADE_LCD_DISABLED] = video->map_color(
+        rgb_lcd_disabled[0], rgb_lcd_disabled[1], rgb_lcd_disabled[2]);
+
+    for (size_t i=0; i<PALETTE_SIZE; i++) {
+        shade_colors[i] = video->map_color(
+            rgb_palette[i][0], rgb_palette[i][1], rgb_palette[i][2]);
     }
-    // Original values
-    else {
-        palette[0] = SDL_MapRGB(pixel_format, 110, 125,  70);
-        palette[1] = SDL_MapRGB(pixel_format,  80, 105,  75);
-        palette[2] = SDL_MapRGB(pixel_format,  60,  90,  85);
-        palette[3] = SDL_MapRGB(pixel_format,  60,  80,  75);
+}
+
+
+/**
+ * @brief      Converts the framebuffer shades to colors in the video sink
+ */
+void PPU::output_frame()
+{
+    for (size_t y=0; y<SCREEN_HEIGHT; y++) {
+        uint32_t *line = video->get_line(y);
+
+        for (size_t x=0; x<SCREEN_WIDTH; x++) {
+            line[x] = shade_colors[framebuffer[y][x]];
+        }
     }
 }
 
 
+/**
+ * @brief      Gets the last lines drawn, SCREEN_WIDTH shades per line
+ * Shades are [0, 3] once BGP/OBP applied or SHADE_LCD_DISABLED
+ * @return     SCREEN_WIDTH * SCREEN_HEIGHT shades
+ */
+const uint8_t *PPU::get_framebuffer()
+{
+    return &framebuffer[0][0];
+}
+
+
 /**
  * @brief      Get corrected WX value
  * @return     The wx value
@@ -655,12 +1008,53 @@ uint8_t PPU::get_wx()
 }
 
 
+/**
+ * @brief      Select how lines are drawn
+ * @param[in]  renderer  RENDERER_SCANLINE (fast) or RENDERER_FIFO (accurate)
+ */
+void PPU::set_renderer(ppu_renderer renderer)
+{
+    this->renderer = renderer;
+}
+
+
+/**
+ * @brief      Skip frames nobody will look at, timings and interrupts are kept
+ * @param[in]  interval  Draw one frame every interval frames (1 draws them all)
+ *                       RENDER_NEVER to never draw
+ */
+void PPU::set_render_interval(size_t interval)
+{
+    render_interval = interval;
+}
+
+
+/**
+ * @brief      Enables OAM search of all lines at once, done again only when
+ *             OAM is written
+ * @param[in]  enabled  false to search OAM on each line
+ */
+void PPU::set_sprite_binning(bool enabled)
+{
+    sprite_binning = enabled;
+    invalidate_sprites();
+}
+
+
 void PPU::set_mmu(MMU *mmu)
 {
     this->mmu = mmu;
 }
 
 
+void PPU::set_video_sink(VideoSink *video)
+{
+    this->video = video;
+
+    map_colors();
+}
+
+
 /**
  * @brief      Draw each tile information as a RGB float for OpenGL in the given buffer
  * Assumes buffer is TILE_WIDTH * TILE_HEIGHT * 3 (RGB) in size
@@ -677,19 +1071,18 @@ void PPU::draw_tile(uint8_t buffer[], size_t tile_id)
         uint8_t data1 = mmu->get_nocheck(line_address);
         uint8_t data2 = mmu->get_nocheck(line_address + 1);
 
+        uint8_t pixels[TILE_WIDTH];
+        decode_tile_line(data1, data2, pixels);
+
         for (size_t x=0; x<TILE_WIDTH; x++) {
-            uint8_t pixel = get_pixel_value(data1, data2, x);
+            uint8_t pixel = pixels[x];
 
             size_t index = (y * TILE_WIDTH) + x;
             index *= 3;     // Three color component
 
-            SDL_GetRGB(
-                palette[pixel],
-                pixel_format,
-                &buffer[index + 0],
-                &buffer[index + 1],
-                &buffer[index + 2]
-            );
+            buffer[index + 0] = rgb_palette[pixel][0];
+            buffer[index + 1] = rgb_palette[pixel][1];
+            buffer[index + 2] = rgb_palette[pixel][2];
         }
     }
 }
@@ -728,11 +1121,8 @@ void PPU::serialize(std::ofstream &file)
 
     file.write(reinterpret_cast<char*>(&current_mode), sizeof(ppu_mode));
 
-    size_t displayable_sprites_count = displayable_sprites.size();
     file.write(reinterpret_cast<char*>(&displayable_sprites_count), sizeof(size_t));
-    for (auto sprite : displayable_sprites) {
-        file.write(reinterpret_cast<const char*>(&sprite), sizeof(Sprite));
-    }
+    file.write(reinterpret_cast<char*>(displayable_sprites), sizeof(Sprite) * displayable_sprites_count);
 }
 
 
@@ -763,11 +1153,12 @@ void PPU::deserialize(std::ifstream &file)
 
     file.read(reinterpret_cast<char*>(&current_mode), sizeof(ppu_mode));
 
-    size_t displayable_sprites_count;
+    invalidate_tiles();
+    invalidate_sprites();
+
     file.read(reinterpret_cast<char*>(&displayable_sprites_count), sizeof(size_t));
-    for (size_t i=0; i<displayable_sprites_count; i++) {
-        Sprite sprite;
-        file.read(reinterpret_cast<char*>(&sprite), sizeof(Sprite));
-        displayable_sprites.push_back(sprite);
+    if (displayable_sprites_count > MAX_SPRITE_DISPLAYED) {
+        displayable_sprites_count = 0;
     }
+    file.read(reinterpret_cast<char*>(displayable_sprites), sizeof(Sprite) * displayable_sprites_count);
 }
@@ -1,13 +1,12 @@
 #ifndef PPU_H
 #define PPU_H
 
-#include <SDL2/SDL.h>
-#include <list>
 #include <iostream>
 #include <fstream>
 
 #include "defines.h"
 #include "mmu.h"
+#include "sink.h"
 
 
 /**
@@ -18,25 +17,30 @@ public:
     size_t clock;
 
     PPU();
-    ~PPU();
 
     bool init();
     void reset();
     void step();
-    void quit();
 
     void set_lcdc(uint8_t lcdc);
     void set_bgp(uint8_t value);
     void set_obp(size_t obp_id, uint8_t value);
 
-    Uint32 get_window_id();
     uint8_t get_current_ly();
     const char *get_current_mode();
 
     void set_palette(size_t palette_index);
+    void set_renderer(ppu_renderer renderer);
+    void set_render_interval(size_t interval);
+    void set_sprite_binning(bool enabled);
     void set_mmu(MMU *mmu);
+    void set_video_sink(VideoSink *video);
+
+    const uint8_t *get_framebuffer();
 
     void draw_tile(uint8_t buffer[], size_t tile_id);
+    void invalidate_tile(uint16_t address);
+    void invalidate_sprites();
 
     void adjust_clocks(size_t adjustment);
 
@@ -45,13 +49,15 @@ public:
 
 private:
     MMU *mmu;
+    VideoSink *video;
 
-    SDL_Window *sdl_window;
-    SDL_Surface *sdl_screen;
-    SDL_PixelFormat *pixel_format;
+    // Colors as RGB components and shades in the video sink format
+    uint8_t rgb_lcd_disabled[3];
+    uint8_t rgb_palette[PALETTE_SIZE][3];
+    uint32_t shade_colors[SHADE_COUNT];
 
-    Uint32 color_lcd_disabled;
-    Uint32 palette[PALETTE_SIZE];
+    // Shade of each pixel, BGP/OBP applied, converted for the sink each frame
+    uint8_t framebuffer[SCREEN_HEIGHT][SCREEN_WIDTH];
 
     uint8_t bg_palette[PALETTE_SIZE];
     uint8_t sprite_palette[SPRITE_PALETTE_COUNT][PALETTE_SIZE];
@@ -67,17 +73,50 @@ private:
     uint16_t bg_map_address;
     uint16_t window_map_address;
 
+    ppu_renderer renderer;
+
+    size_t render_interval;     // Draw one frame every render_interval frames
+    size_t frame_count;         // Frames since reset
+
+    // Tiles decoded as one color index per pixel, decoded again once written
+    uint8_t tile_cache[TILE_COUNT][TILE_HEIGHT][TILE_WIDTH];
+    bool tile_dirty[TILE_COUNT];
+
+    Pixel line_pixels[LINE_X_COUNT];    // Line being composed by render_line
+
     Pixel pixel_fifo[FIFO_SIZE];
     size_t pf_size;             // How many pixels in the FIFO
     size_t pf_index;            // Position in the FIFO
 
     uint8_t current_ly;                     // Line that was being drawn
     ppu_mode current_mode;
-    std::list<Sprite> displayable_sprites;  // Contains results of OAM search
+
+    // Results of OAM search sorted by X, OAM order for the same X
+    Sprite displayable_sprites[MAX_SPRITE_DISPLAYED];
+    size_t displayable_sprites_count;
+
+    // OAM ids of the sprites of each line, built again once OAM is written
+    bool sprite_binning;
+    bool sprite_bins_dirty;
+    uint8_t sprite_bins[LINE_Y_COUNT][MAX_SPRITE_DISPLAYED];
+    size_t sprite_bins_count[LINE_Y_COUNT];
+
+    bool is_frame_rendered();
 
     void oam_search(uint8_t ly);
+    void bin_sprites();
+    void add_displayable_sprite(size_t oam_id);
     void pixel_transfer(uint8_t ly);
 
+    void render_line(uint8_t ly);
+    void render_map(
+        uint16_t map_address, size_t map_x, size_t map_y,
+        size_t start, size_t end);
+    void render_sprites(uint8_t ly, size_t window_x);
+    const uint8_t *get_tile_line(size_t tile_index, size_t y);
+    size_t get_bg_tile_index(uint16_t map_address);
+    void invalidate_tiles();
+
     void fetch(size_t x, size_t ly, pixel_type type);
     void fetch_bg(size_t x, size_t ly);
     void fetch_window(size_t x, size_t ly);
@@ -89,6 +128,8 @@ private:
     void clear_fifo();
     Pixel pop_pixel();
 
+    void map_colors();
+    void output_frame();
     void update_lcd_status();
     void update_interrupts(uint8_t old_status, uint8_t new_status);
 
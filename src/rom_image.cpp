@@ -0,0 +1,134 @@
+#include "rom_image.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log.h"
+
+
+std::map<RomImage::file_key, RomImage *> RomImage::images;
+std::mutex RomImage::images_lock;
+
+
+RomImage::RomImage() :
+    references(0), data(nullptr), size(0), mapped(false)
+{
+
+}
+
+
+RomImage::~RomImage()
+{
+    if (mapped) {
+        munmap(data, size);
+    } else {
+        delete[] data;
+    }
+}
+
+
+/**
+ * @brief      Gives the image of a ROM file, loading it if nobody did yet
+ * @param[in]  path  The ROM file
+ * @return     The image, nullptr if the file cannot be read
+ */
+RomImage *RomImage::acquire(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    file_key key(status.st_dev, status.st_ino, status.st_size, status.st_mtime);
+
+    std::lock_guard<std::mutex> guard(images_lock);
+
+    auto found = images.find(key);
+    if (found != images.end()) {
+        close(fd);
+
+        found->second->references++;
+        return found->second;
+    }
+
+    RomImage *image = new RomImage();
+    image->key = key;
+    image->size = status.st_size;
+
+    bool success = image->open(fd);
+    close(fd);
+
+    if (!success) {
+        delete image;
+        return nullptr;
+    }
+
+    image->references = 1;
+    images[key] = image;
+
+    return image;
+}
+
+
+/**
+ * @brief      Lets go of an image, the last user frees it
+ * @param      image  The image, may be nullptr
+ */
+void RomImage::release(RomImage *image)
+{
+    if (image == nullptr) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(images_lock);
+
+    image->references--;
+    if (image->references > 0) {
+        return;
+    }
+
+    images.erase(image->key);
+    delete image;
+}
+
+
+/**
+ * @brief      Maps the file, or reads it at once when it cannot be mapped
+ * @param[in]  fd    The file, size is already known
+ * @return     true on success
+ */
+bool RomImage::open(int fd)
+{
+    void *address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (address != MAP_FAILED) {
+        data = static_cast<uint8_t *>(address);
+        mapped = true;
+        return true;
+    }
+
+    debug("Unable to map the ROM, reading it instead\n");
+
+    data = new uint8_t[size];
+    mapped = false;
+
+    size_t total = 0;
+    while (total < size) {
+        ssize_t count = read(fd, data + total, size - total);
+        if (count <= 0) {
+            error("Unable to read the ROM file\n");
+            return false;
+        }
+
+        total += count;
+    }
+
+    return true;
+}
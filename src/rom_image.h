@@ -0,0 +1,49 @@
+#ifndef ROM_IMAGE_H
+#define ROM_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+
+/**
+ * @brief      Read-only content of a ROM file, shared by everyone loading it
+ *
+ * The file is memory mapped so nothing is read until used, and the pages
+ * are shared with other processes mapping it. Emulators of a same process
+ * loading the same file get the same image, released with the last of them.
+ */
+class RomImage {
+    // Device, inode, size and modification time of the file
+    typedef std::tuple<dev_t, ino_t, off_t, time_t> file_key;
+
+    static std::map<file_key, RomImage *> images;
+    static std::mutex images_lock;
+
+    file_key key;
+    size_t references;
+
+    uint8_t *data;
+    size_t size;
+    bool mapped;            // Otherwise copied in memory
+
+    RomImage();
+    ~RomImage();
+
+    bool open(int fd);
+
+public:
+    static RomImage *acquire(const std::string &path);
+    static void release(RomImage *image);
+
+    const uint8_t *get_data() { return data; };
+    size_t get_size() { return size; };
+};
+
+#endif /* ROM_IMAGE_H */
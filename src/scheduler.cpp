@@ -0,0 +1,157 @@
+#include "scheduler.h"
+
+#include "log.h"
+
+
+Scheduler::Scheduler()
+{
+    reset();
+}
+
+
+void Scheduler::reset()
+{
+    count = 0;
+}
+
+
+/**
+ * @brief      Order events by deadline then by type
+ * @return     true if a must be processed before b
+ */
+bool Scheduler::before(const Event &a, const Event &b)
+{
+    if (a.deadline != b.deadline) {
+        return a.deadline < b.deadline;
+    }
+
+    return a.type < b.type;
+}
+
+
+void Scheduler::sift_up(size_t index)
+{
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!before(heap[index], heap[parent])) {
+            break;
+        }
+
+        Event tmp = heap[parent];
+        heap[parent] = heap[index];
+        heap[index] = tmp;
+
+        index = parent;
+    }
+}
+
+
+void Scheduler::sift_down(size_t index)
+{
+    while (true) {
+        size_t smallest = index;
+        size_t left = (index * 2) + 1;
+        size_t right = left + 1;
+
+        if (left < count && before(heap[left], heap[smallest])) {
+            smallest = left;
+        }
+        if (right < count && before(heap[right], heap[smallest])) {
+            smallest = right;
+        }
+
+        if (smallest == index) {
+            break;
+        }
+
+        Event tmp = heap[smallest];
+        heap[smallest] = heap[index];
+        heap[index] = tmp;
+
+        index = smallest;
+    }
+}
+
+
+void Scheduler::remove_at(size_t index)
+{
+    count -= 1;
+    if (index == count) {
+        return;
+    }
+
+    heap[index] = heap[count];
+    sift_up(index);
+    sift_down(index);
+}
+
+
+/**
+ * @brief      Schedule an event, moves it if it is already pending
+ * @param[in]  type      The event type
+ * @param[in]  deadline  Absolute clock at which the event fires
+ */
+void Scheduler::post(event_type type, size_t deadline)
+{
+    for (size_t i=0; i<count; i++) {
+        if (heap[i].type == type) {
+            heap[i].deadline = deadline;
+            sift_up(i);
+            sift_down(i);
+            return;
+        }
+    }
+
+    if (count >= SCHEDULER_CAPACITY) {
+        error("Scheduler is full, event %d dropped\n", type);
+        return;
+    }
+
+    heap[count].type = type;
+    heap[count].deadline = deadline;
+    sift_up(count);
+    count += 1;
+}
+
+
+/**
+ * @brief      Removes the pending event of the given type (if any)
+ * @param[in]  type  The event type
+ */
+void Scheduler::cancel(event_type type)
+{
+    for (size_t i=0; i<count; i++) {
+        if (heap[i].type == type) {
+            remove_at(i);
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief      Removes the earliest event
+ * @return     Type of the removed event
+ */
+event_type Scheduler::pop()
+{
+    event_type type = heap[0].type;
+
+    remove_at(0);
+
+    return type;
+}
+
+
+bool Scheduler::is_empty()
+{
+    return count == 0;
+}
+
+
+void Scheduler::adjust_clocks(size_t adjustment)
+{
+    for (size_t i=0; i<count; i++) {
+        heap[i].deadline -= adjustment;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defines.h"
+
+
+struct Event {
+    size_t deadline;        // Absolute clock at which the event fires
+    event_type type;
+};
+
+
+/**
+ * @brief      Keeps track of when each sub-system needs to be stepped
+ *
+ * Fixed capacity min-heap keyed on the absolute clock. Each event type can
+ * only be pending once, posting it again moves its deadline.
+ * Ties are resolved by event type so processing order stays deterministic.
+ */
+class Scheduler {
+    Event heap[SCHEDULER_CAPACITY];
+    size_t count;
+
+    bool before(const Event &a, const Event &b);
+    void sift_up(size_t index);
+    void sift_down(size_t index);
+    void remove_at(size_t index);
+
+public:
+    Scheduler();
+
+    void reset();
+
+    void post(event_type type, size_t deadline);
+    void cancel(event_type type);
+
+    /**
+     * @brief      Clock of the earliest pending event
+     * @return     The deadline or SIZE_MAX when nothing is pending
+     */
+    size_t get_next_deadline() { return count > 0 ? heap[0].deadline : SIZE_MAX; };
+    event_type pop();
+    bool is_empty();
+
+    void adjust_clocks(size_t adjustment);
+};
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,37 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * @brief      Abstract class to video outputs
+ *
+ * The PPU draws its lines in the buffer provided by the sink and tells it
+ * when a frame is complete. Without any sink, nothing is drawn.
+ */
+class VideoSink {
+public:
+    virtual ~VideoSink() = default;
+
+    virtual uint32_t map_color(uint8_t red, uint8_t green, uint8_t blue) = 0;
+    virtual uint32_t *get_line(size_t y) = 0;
+    virtual void present() = 0;
+};
+
+
+/**
+ * @brief      Abstract class to audio outputs
+ *
+ * The APU hands over blocks of interleaved stereo samples (left then right).
+ * Without any sink, samples are dropped.
+ */
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+
+    virtual void queue(const int16_t *samples, size_t count) = 0;
+};
+
+#endif /* SINK_H */
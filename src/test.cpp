@@ -1,9 +1,18 @@
 #include "test.h"
 
+#include <algorithm>
+#include <cstring>
 #include <initializer_list>
+#include <fstream>
+#include <iterator>
+#include <vector>
 
 #include "log.h"
+#include "utils.h"
 #include "dmg.h"
+#include "mbc/mbc3.h"
+#include "mbc/mbc5.h"
+#include "gui/frontend.h"
 
 Cartridge *cart;
 MMU *mmu;
@@ -23,7 +32,7 @@ void init(uint8_t value)
 
     cpu->PC = 0x00;
 
-    cpu->reg[F] = 0x00;
+    cpu->set_F(0x00);
 
     cpu->reg[B] = value;
     cpu->reg[C] = value;
@@ -78,6 +87,61 @@ bool test_MMU_ram()
 }
 
 
+bool test_MMU_echo()
+{
+    mmu->set(0xC123, 0x42);
+    ASSERT(mmu->get(0xE123) == 0x42);
+
+    mmu->set(0xFDFF, 0x24);
+    ASSERT(mmu->get(0xDDFF) == 0x24);
+
+    return true;
+}
+
+
+bool test_MMU_io_masks()
+{
+    uint8_t interrupts = mmu->get(IF_ADDRESS);
+
+    mmu->set(IF_ADDRESS, 0x00);
+    ASSERT(mmu->get(IF_ADDRESS) == 0xE0);
+    ASSERT(mmu->get(FF_START) == 0xFF);
+    ASSERT(mmu->get(FF_END) == 0xFF);
+
+    mmu->set(IF_ADDRESS, interrupts);
+
+    return true;
+}
+
+
+bool test_MMU_bank_switch()
+{
+    const char *path = "tests/blargg/cpu/cpu_instrs.gb";
+    MMU memory;
+    ASSERT(memory.load_rom(path));
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> rom(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT(rom.size() == 4 * MBC_SIZE);
+
+    for (uint8_t bank=1; bank<4; bank++) {
+        memory.set(0x2000, bank);
+
+        for (uint16_t address=ROM1_START; address<=ROM1_END; address+=0x0123) {
+            size_t offset = (bank * MBC_SIZE) + (address - ROM1_START);
+            ASSERTV(memory.get(address) == rom[offset],
+                "bank: %u address: 0x%04X\n", bank, address);
+        }
+    }
+
+    // ROM0 is not switched
+    ASSERT(memory.get(0x0134) == rom[0x0134]);
+
+    return true;
+}
+
+
 /****************************************************************
  *
  *      TEST CPU OPERATIONS
@@ -403,7 +467,7 @@ bool test_CPU_ADD()
 
     cpu->reg[A] = 0x00;
     cpu->reg[B] = 0xFF;
-    cpu->reg[F] = 0xFF;
+    cpu->set_F(0xFF);
     cpu->step();
     ASSERT(cpu->get_flag(FH));
     ASSERT(cpu->get_flag(FC));
@@ -473,7 +537,7 @@ bool test_CPU_SUB()
 
     cpu->reg[A] = 0x00;
     cpu->reg[B] = 0xFF;
-    cpu->reg[F] = 0xFF;
+    cpu->set_F(0xFF);
     cpu->step();
     ASSERT(cpu->get_flag(FH));
     ASSERT(cpu->get_flag(FC));
@@ -653,7 +717,7 @@ bool test_CPU_PUSH_POP()
     init(0x00);
 
     cpu->reg[A] = 0x11;
-    cpu->reg[F] = 0x22;
+    cpu->set_F(0x22);
     cpu->reg[B] = 0x33;
     cpu->reg[C] = 0x44;
     cpu->reg[D] = 0x55;
@@ -689,8 +753,8 @@ bool test_CPU_PUSH_POP()
     ASSERT(cpu->reg[H] == 0x77);
     ASSERT(cpu->reg[L] == 0x88);
 
-    ASSERT(cpu->reg[A] = 0x11);
-    ASSERT(cpu->reg[F] = 0x22);
+    ASSERT(cpu->reg[A] == 0x11);
+    ASSERT(cpu->get_F() == 0x20);
 
     cpu->step();
     cpu->step();
@@ -698,7 +762,7 @@ bool test_CPU_PUSH_POP()
     cpu->step();
 
     ASSERTV(cpu->reg[B] == 0x11, "B: 0x%02X\n", cpu->reg[B]);
-    ASSERTV(cpu->reg[C] == 0x22, "C: 0x%02X\n", cpu->reg[C]);
+    ASSERTV(cpu->reg[C] == 0x20, "C: 0x%02X\n", cpu->reg[C]);
 
     ASSERT(cpu->reg[D] == 0x77);
     ASSERT(cpu->reg[E] == 0x88);
@@ -706,8 +770,8 @@ bool test_CPU_PUSH_POP()
     ASSERT(cpu->reg[H] == 0x55);
     ASSERT(cpu->reg[L] == 0x66);
 
-    ASSERT(cpu->reg[A] = 0x33);
-    ASSERT(cpu->reg[F] = 0x44);
+    ASSERT(cpu->reg[A] == 0x33);
+    ASSERT(cpu->get_F() == 0x40);
 
     return true;
 }
@@ -928,6 +992,254 @@ bool test_CPU_Op_SP()
     return true;
 }
 
+bool test_CPU_lazy_flags()
+{
+    init(0x00);
+
+    cpu->PC = WRAM0_START;
+    cpu->reg[A] = 0xF0;
+    cpu->reg[B] = 0x0F;
+
+    execute({ 0xC6, 0x20 });    // ADD A,0x20
+    ASSERT(cpu->reg[A] == 0x10);
+
+    // Carry of the ADD kept by INC
+    execute({ 0x04 });          // INC B
+
+    uint16_t pc = cpu->PC;
+    execute({ 0x38, 0x02 });    // JR C,+2
+    ASSERTV(cpu->PC == pc + 4, "PC: 0x%04X\n", cpu->PC);
+    ASSERTV(cpu->get_F() == 0x30, "F: 0x%02X\n", cpu->get_F());
+
+    // Carry in is the one computed from the ADD
+    execute({ 0xDE, 0x0F });    // SBC A,0x0F
+    ASSERT(cpu->reg[A] == 0x00);
+
+    // Flags pushed are the ones of the SBC
+    execute({ 0xF5 });          // PUSH AF
+    ASSERTV(mmu->get(cpu->reg16(SP)) == 0xE0, "F: 0x%02X\n", mmu->get(cpu->reg16(SP)));
+
+    execute({ 0xFE, 0x01 });    // CP 0x01
+    execute({ 0xCB, 0x10 });    // RL B
+    ASSERT(cpu->reg[B] == 0x21);
+    ASSERTV(cpu->get_F() == 0x00, "F: 0x%02X\n", cpu->get_F());
+
+    return true;
+}
+
+bool test_CPU_HALT_fast_forward()
+{
+    init(0x00);
+
+    mmu->set(IE_ADDRESS, 0x00);
+    mmu->set(IF_ADDRESS, 0x00);
+
+    cpu->PC = WRAM0_START;
+    execute({ 0x76 });      // HALT
+    ASSERTV(cpu->clock == 4, "clock: %zu\n", cpu->clock);
+
+    // Same clock as halted steps until after the deadline
+    cpu->fast_forward(100);
+    ASSERTV(cpu->clock == 104, "clock: %zu\n", cpu->clock);
+
+    // Pending interrupt wakes the CPU up
+    mmu->set(IE_ADDRESS, INT_TIMER_MASK);
+    mmu->set(IF_ADDRESS, INT_TIMER_MASK);
+    cpu->fast_forward(200);
+    ASSERTV(cpu->clock == 104, "clock: %zu\n", cpu->clock);
+
+    mmu->set(IE_ADDRESS, 0x00);
+    mmu->set(IF_ADDRESS, 0x00);
+
+    return true;
+}
+
+
+/**
+ * @brief      Runs a CPU up to the deadline the way DMG::process does
+ * @param      target    The CPU
+ * @param[in]  deadline  Clock of the next event
+ * @param[in]  skip      Fast forward after each step or only step
+ * @return     How many instructions were stepped
+ */
+size_t run_until(CPU *target, size_t deadline, bool skip)
+{
+    size_t steps = 0;
+
+    while (target->clock <= deadline) {
+        target->step();
+        steps++;
+
+        if (skip) {
+            target->fast_forward(deadline);
+        }
+    }
+
+    return steps;
+}
+
+/**
+ * @brief      Writes a ROM image to a file
+ * @param[in]  path  The path
+ * @param[in]  rom   The ROM
+ */
+void write_rom(const char *path, const std::vector<uint8_t> &rom)
+{
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(rom.data()), rom.size());
+}
+
+
+/**
+ * @brief      Loads a ROM in a standalone MMU and CPU
+ * @param      target_mmu  The MMU
+ * @param      target_cpu  The CPU
+ * @param[in]  path        The ROM path
+ */
+void load_system(MMU *target_mmu, CPU *target_cpu, const char *path)
+{
+    target_mmu->set_ppu(ppu);
+    target_mmu->set_timer(timer);
+    target_mmu->set_input(input);
+    target_mmu->set_apu(apu);
+    target_mmu->init("", path);
+    target_mmu->set(IE_ADDRESS, 0x00);
+    target_mmu->set(IF_ADDRESS, 0x00);
+
+    target_cpu->set_mmu(target_mmu);
+    target_cpu->init();
+    target_cpu->reset();
+}
+
+
+bool test_CPU_polling_loop_fast_forward()
+{
+    // LDH A,(LY) / CP 0x90 / JR NZ,-6 then NOPs
+    std::vector<uint8_t> rom(2 * MBC_SIZE);
+    const uint8_t loop[] = { 0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA };
+    memcpy(rom.data() + 0x0200, loop, sizeof(loop));
+
+    const char *path = "tests/polling_loop.gb";
+    write_rom(path, rom);
+
+    MMU mmus[2];
+    CPU cpus[2];
+    for (size_t i=0; i<2; i++) {
+        load_system(&mmus[i], &cpus[i], path);
+        mmus[i].set_nocheck(LY, 0x00);
+        cpus[i].PC = 0x0200;
+    }
+    std::remove(path);
+
+    CPU *skipped = &cpus[0];
+    CPU *stepped = &cpus[1];
+
+    // Deadline reached while still polling
+    size_t skipped_steps = run_until(skipped, 10000, true);
+    size_t stepped_steps = run_until(stepped, 10000, false);
+    ASSERTV(skipped_steps < stepped_steps, "steps: %zu %zu\n", skipped_steps, stepped_steps);
+
+    ASSERTV(skipped->clock == stepped->clock, "clock: %zu %zu\n", skipped->clock, stepped->clock);
+    ASSERTV(skipped->PC == stepped->PC, "PC: 0x%04X 0x%04X\n", skipped->PC, stepped->PC);
+    ASSERT(skipped->reg[A] == stepped->reg[A]);
+    ASSERT(skipped->get_F() == stepped->get_F());
+
+    // Event: LY reaches the value, the loop exits
+    mmus[0].set_nocheck(LY, 0x90);
+    mmus[1].set_nocheck(LY, 0x90);
+
+    run_until(skipped, 20000, true);
+    run_until(stepped, 20000, false);
+
+    ASSERTV(skipped->clock == stepped->clock, "clock: %zu %zu\n", skipped->clock, stepped->clock);
+    ASSERTV(skipped->PC == stepped->PC, "PC: 0x%04X 0x%04X\n", skipped->PC, stepped->PC);
+    ASSERT(skipped->PC > 0x0205);
+    ASSERT(skipped->reg[A] == 0x90 && stepped->reg[A] == 0x90);
+    ASSERT(skipped->get_F() == stepped->get_F());
+    ASSERT(get_bit(skipped->get_F(), FZ));
+
+    return true;
+}
+
+bool test_CPU_code_cache_bank_switch()
+{
+    // LD A,0x11 in bank 1 and LD A,0x22 in bank 2, both at 0x4000
+    std::vector<uint8_t> rom(4 * MBC_SIZE);
+    rom[CARTRIDGE_TYPE_ADDRESS] = CART_TYPE_MBC1;
+    rom[ROM_SIZE_ADDRESS] = 0x01;
+    rom[1 * MBC_SIZE] = 0x3E;
+    rom[1 * MBC_SIZE + 1] = 0x11;
+    rom[2 * MBC_SIZE] = 0x3E;
+    rom[2 * MBC_SIZE + 1] = 0x22;
+
+    const char *path = "tests/code_cache.gb";
+    write_rom(path, rom);
+
+    MMU local_mmu;
+    CPU local_cpu;
+    load_system(&local_mmu, &local_cpu, path);
+    std::remove(path);
+
+    local_cpu.PC = 0x4000;
+    local_cpu.step();
+    ASSERTV(local_cpu.reg[A] == 0x11, "A: 0x%02X\n", local_cpu.reg[A]);
+
+    // Same address, other bank: the cached instruction must not be reused
+    local_mmu.set(0x2000, 0x02);
+    local_cpu.PC = 0x4000;
+    local_cpu.step();
+    ASSERTV(local_cpu.reg[A] == 0x22, "A: 0x%02X\n", local_cpu.reg[A]);
+
+    local_mmu.set(0x2000, 0x01);
+    local_cpu.PC = 0x4000;
+    local_cpu.step();
+    ASSERTV(local_cpu.reg[A] == 0x11, "A: 0x%02X\n", local_cpu.reg[A]);
+
+    return true;
+}
+
+bool test_CPU_code_cache_remap()
+{
+    // LD A,0x11 at 0x0200
+    std::vector<uint8_t> rom(2 * MBC_SIZE);
+    rom[0x0200] = 0x3E;
+    rom[0x0201] = 0x11;
+
+    const char *path = "tests/code_cache.gb";
+    write_rom(path, rom);
+
+    MMU local_mmu;
+    CPU local_cpu;
+    load_system(&local_mmu, &local_cpu, path);
+
+    local_cpu.PC = 0x0200;
+    local_cpu.step();
+    ASSERTV(local_cpu.reg[A] == 0x11, "A: 0x%02X\n", local_cpu.reg[A]);
+
+    // Patch the mapped file in place: same pages, new operand
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(0x0201);
+        file.put(0x22);
+    }
+    std::remove(path);
+
+    // Without a remap the decoded instruction is still used
+    local_cpu.PC = 0x0200;
+    local_cpu.step();
+    ASSERTV(local_cpu.reg[A] == 0x11, "A: 0x%02X\n", local_cpu.reg[A]);
+
+    // Remapping the pages invalidates the whole cache
+    size_t version = local_mmu.get_code_version();
+    local_mmu.reset();
+    ASSERT(local_mmu.get_code_version() != version);
+
+    local_cpu.PC = 0x0200;
+    local_cpu.step();
+    ASSERTV(local_cpu.reg[A] == 0x22, "A: 0x%02X\n", local_cpu.reg[A]);
+
+    return true;
+}
 
 /****************************************************************
  *
@@ -941,7 +1253,7 @@ bool test_BIN_RLC()
 
     execute({ 0xCB, 0x00 });    // RLC B
     ASSERT(cpu->reg[B] == 0b11100001);
-    ASSERT(cpu->reg[F] == 0x10);    // Test carry flag
+    ASSERT(cpu->get_F() == 0x10);    // Test carry flag
     execute({ 0xCB, 0x00 });    // RLC B
     ASSERT(cpu->reg[B] == 0b11000011);
     execute({ 0xCB, 0x01 });    // RLC C
@@ -964,7 +1276,7 @@ bool test_BIN_RLC()
     // Test zero flag
     init(0x00);
     execute({ 0xCB, 0x08 });
-    ASSERT(cpu->reg[F] == 0b10000000);
+    ASSERT(cpu->get_F() == 0b10000000);
 
     return true;
 }
@@ -989,7 +1301,7 @@ bool test_BIN_RRC()
     ASSERT(cpu->reg[L] == 0b10000111);
     execute({ 0xCB, 0x0F });    // RRC A
     ASSERT(cpu->reg[A] == 0b10000111);
-    ASSERT(cpu->reg[F] == 0x10);    // Test carry flag
+    ASSERT(cpu->get_F() == 0x10);    // Test carry flag
 
     mmu->set(cpu->reg16(HL), 0x0F);
     execute({ 0xCB, 0x0E });    // RRC (HL)
@@ -998,7 +1310,7 @@ bool test_BIN_RRC()
     // Test zero flag
     init(0x00);
     execute({ 0xCB, 0x08 });
-    ASSERT(cpu->reg[F] == 0b10000000);
+    ASSERT(cpu->get_F() == 0b10000000);
 
     return true;
 }
@@ -1008,7 +1320,7 @@ bool test_BIN_RL()
     init(0xF0);
 
     execute({ 0xCB, 0x10 });
-    ASSERTV(cpu->reg[B] == 0b11100000, "B=0x%02X F=0x%02X\n", cpu->reg[B], cpu->reg[F]);
+    ASSERTV(cpu->reg[B] == 0b11100000, "B=0x%02X F=0x%02X\n", cpu->reg[B], cpu->get_F());
     execute({ 0xCB, 0x10 });
     ASSERT(cpu->reg[B] == 0b11000001);
     execute({ 0xCB, 0x11 });
@@ -1023,7 +1335,7 @@ bool test_BIN_RL()
     ASSERT(cpu->reg[L] == 0b11100001);
     execute({ 0xCB, 0x17 });
     ASSERT(cpu->reg[A] == 0b11100001);
-    ASSERT(cpu->reg[F] == 0x10);    // Test carry flag
+    ASSERT(cpu->get_F() == 0x10);    // Test carry flag
 
     mmu->set(cpu->reg16(HL), 0xF0);
     execute({ 0xCB, 0x16 });
@@ -1032,7 +1344,7 @@ bool test_BIN_RL()
     // Test zero flag
     init(0x00);
     execute({ 0xCB, 0x10 });
-    ASSERT(cpu->reg[F] == 0b10000000);
+    ASSERT(cpu->get_F() == 0b10000000);
 
     return true;
 }
@@ -1057,7 +1369,7 @@ bool test_BIN_RR()
     ASSERT(cpu->reg[L] == 0b10000111);
     execute({ 0xCB, 0x1F });
     ASSERT(cpu->reg[A] == 0b10000111);
-    ASSERT(cpu->reg[F] == 0x10);    // Test carry flag
+    ASSERT(cpu->get_F() == 0x10);    // Test carry flag
 
     mmu->set(cpu->reg16(HL), 0x0F);
     execute({ 0xCB, 0x1E });
@@ -1066,7 +1378,7 @@ bool test_BIN_RR()
     // Test zero flag
     init(0x00);
     execute({ 0xCB, 0x18 });
-    ASSERT(cpu->reg[F] == 0b10000000);
+    ASSERT(cpu->get_F() == 0b10000000);
 
     return true;
 }
@@ -1091,7 +1403,7 @@ bool test_BIN_SLA()
     ASSERT(cpu->reg[L] == 0b11100000);
     execute({ 0xCB, 0x27 });
     ASSERT(cpu->reg[A] == 0b11100000);
-    ASSERT(cpu->reg[F] == 0x10);    // Test carry flag
+    ASSERT(cpu->get_F() == 0x10);    // Test carry flag
 
     mmu->set(cpu->reg16(HL), 0xF0);
     execute({ 0xCB, 0x26 });
@@ -1099,7 +1411,7 @@ bool test_BIN_SLA()
 
     init(0x80);
     execute({ 0xCB, 0x20 });
-    ASSERT(cpu->reg[F] == 0x90);    // Test zero flag flag
+    ASSERT(cpu->get_F() == 0x90);    // Test zero flag flag
 
     return true;
 }
@@ -1131,7 +1443,7 @@ bool test_BIN_SRA()
 
     init(0x01);
     execute({ 0xCB, 0x28 });
-    ASSERTV(cpu->reg[F] == 0x90, "F:%02X\n", cpu->reg[F]);    // Test zero/carry flag flag
+    ASSERTV(cpu->get_F() == 0x90, "F:%02X\n", cpu->get_F());    // Test zero/carry flag flag
 
     return true;
 }
@@ -1164,7 +1476,7 @@ bool test_BIN_SWAP()
 
     init(0x00);
     execute({ 0xCB, 0x30 });
-    ASSERT(cpu->reg[F] == 0x80);    // Test zero flag flag
+    ASSERT(cpu->get_F() == 0x80);    // Test zero flag flag
 
     return true;
 }
@@ -1189,7 +1501,7 @@ bool test_BIN_SRL()
     ASSERT(cpu->reg[L] == 0b01000111);
     execute({ 0xCB, 0x3F });
     ASSERT(cpu->reg[A] == 0b01000111);
-    ASSERT(cpu->reg[F] == 0x10);    // Test carry flag
+    ASSERT(cpu->get_F() == 0x10);    // Test carry flag
 
     cpu->reg[H] = 0x80;
     mmu->set(cpu->reg16(HL), 0b10001111);
@@ -1198,7 +1510,7 @@ bool test_BIN_SRL()
 
     init(0b00000001);
     execute({ 0xCB, 0x38 });
-    ASSERT(cpu->reg[F] == 0x90);    // Test zero flag flag
+    ASSERT(cpu->get_F() == 0x90);    // Test zero flag flag
 
     return true;
 }
@@ -1217,7 +1529,7 @@ bool test_BIN_BIT()
         }
 
         execute({ 0xCB, command });
-        ASSERTV((cpu->reg[F] & 0xF0) == 0x20, "F: 0x%02X opcode: 0x%02X\n", cpu->reg[F], command);
+        ASSERTV((cpu->get_F() & 0xF0) == 0x20, "F: 0x%02X opcode: 0x%02X\n", cpu->get_F(), command);
 
         /* (HL) special case */
         if (offset % 8 == 6) {
@@ -1228,7 +1540,7 @@ bool test_BIN_BIT()
         }
 
         execute({ 0xCB, command });
-        ASSERTV((cpu->reg[F] & 0xF0) == 0xA0, "00 value=%02X offset=%d\n", cpu->reg[F], offset);
+        ASSERTV((cpu->get_F() & 0xF0) == 0xA0, "00 value=%02X offset=%d\n", cpu->get_F(), offset);
     }
 
     return true;
@@ -1456,6 +1768,635 @@ bool test_graphic_routine()
 }
 
 
+/****************************************************************
+ *
+ *      TEST SCHEDULER
+ *
+ ****************************************************************/
+
+bool test_SCHEDULER_order()
+{
+    Scheduler scheduler;
+
+    ASSERT(scheduler.is_empty());
+    ASSERT(scheduler.get_next_deadline() == SIZE_MAX);
+
+    scheduler.post(EVENT_APU, 100);
+    scheduler.post(EVENT_TIMER, 50);
+    scheduler.post(EVENT_PPU, 100);
+
+    ASSERT(scheduler.get_next_deadline() == 50);
+    ASSERT(scheduler.pop() == EVENT_TIMER);
+
+    // Same deadline: PPU goes before APU
+    ASSERT(scheduler.get_next_deadline() == 100);
+    ASSERT(scheduler.pop() == EVENT_PPU);
+
+    // Posting again moves the pending event
+    scheduler.post(EVENT_APU, 10);
+    ASSERT(scheduler.get_next_deadline() == 10);
+    ASSERT(scheduler.pop() == EVENT_APU);
+    ASSERT(scheduler.is_empty());
+
+    scheduler.post(EVENT_PPU, 30);
+    scheduler.post(EVENT_TIMER, 20);
+    scheduler.cancel(EVENT_TIMER);
+    ASSERT(scheduler.get_next_deadline() == 30);
+
+    scheduler.adjust_clocks(25);
+    ASSERT(scheduler.get_next_deadline() == 5);
+
+    return true;
+}
+
+
+/****************************************************************
+ *
+ *      TEST TIMER
+ *
+ ****************************************************************/
+
+bool test_TIMER_overflow_event()
+{
+    timer->reset();
+
+    mmu->set(IF_ADDRESS, 0x00);
+    mmu->set(TMA, 0x42);
+    mmu->set(TIMA, 0xFE);
+
+    // Stopped: no overflow to expect
+    ASSERTV(timer->clock == SIZE_MAX, "clock: %zu\n", timer->clock);
+
+    // Every 16 cycles, two increments to go
+    mmu->set(TAC, TIMER_START | 0x01);
+    ASSERTV(timer->clock == 32, "clock: %zu\n", timer->clock);
+
+    timer->step();
+    ASSERT(mmu->get(TIMA) == 0x42);
+    ASSERT(mmu->get(IF_ADDRESS) & INT_TIMER_MASK);
+    ASSERTV(timer->clock == 32 + (0x100 - 0x42) * 16, "clock: %zu\n", timer->clock);
+
+    // Written value counts from the last increment
+    mmu->set(TIMA, 0xF0);
+    ASSERTV(timer->clock == 32 + 0x10 * 16, "clock: %zu\n", timer->clock);
+
+    mmu->set(TAC, 0x00);
+    ASSERT(timer->clock == SIZE_MAX);
+
+    mmu->set(IF_ADDRESS, 0x00);
+
+    return true;
+}
+
+
+/****************************************************************
+ *
+ *      TEST PPU
+ *
+ ****************************************************************/
+
+/**
+ * @brief      Keeps the frame in memory
+ */
+class TestVideoSink : public VideoSink {
+public:
+    uint32_t pixels[SCREEN_HEIGHT][SCREEN_WIDTH];
+    size_t presented;
+
+    TestVideoSink() : presented(0) {};
+
+    uint32_t map_color(uint8_t red, uint8_t green, uint8_t blue) { return (red << 16) | (green << 8) | blue; };
+    uint32_t *get_line(size_t y) { return pixels[y]; };
+    void present() { presented++; };
+};
+
+/**
+ * @brief      Draws the 144 lines of a frame
+ */
+void render_frame(MMU &memory, PPU &graphics, ppu_renderer renderer, uint8_t lcdc)
+{
+    graphics.reset();
+    graphics.set_renderer(renderer);
+    memory.set(LCDC, lcdc);
+
+    // OAM search, pixel transfer then H-Blank for each line
+    for (size_t i=0; i<LINE_Y_COUNT * 3; i++) {
+        graphics.step();
+    }
+}
+
+bool test_PPU_tile_line_decoding()
+{
+    uint8_t pixels[TILE_WIDTH];
+
+    for (size_t data1=0; data1<256; data1++) {
+        for (size_t data2=0; data2<256; data2++) {
+            decode_tile_line(data1, data2, pixels);
+
+            for (size_t x=0; x<TILE_WIDTH; x++) {
+                ASSERT_QUIET_SUCCESS(
+                    pixels[x] == get_pixel_value(data1, data2, x),
+                    "data: %02zX %02zX x: %zu", data1, data2, x);
+            }
+        }
+    }
+
+    // Low bits first
+    decode_tile_line(0x3C, 0x7E, pixels);
+    ASSERT(pixels[0] == 0);
+    ASSERT(pixels[1] == 2);
+    ASSERT(pixels[2] == 3);
+    ASSERT(pixels[7] == 0);
+
+    return true;
+}
+
+bool test_PPU_scanline_renderer()
+{
+    MMU memory;
+    PPU graphics;
+    uint8_t reference[SCREEN_HEIGHT * SCREEN_WIDTH];
+
+    memory.set_ppu(&graphics);
+    graphics.set_mmu(&memory);
+    graphics.init();
+
+    // Random tiles, maps and sprites
+    uint32_t seed = 42;
+    for (uint16_t address=VRAM_START; address<=VRAM_END; address++) {
+        seed = seed * 1103515245 + 12345;
+        memory.set(address, seed >> 16);
+    }
+    for (uint16_t address=OAM_START; address<=OAM_END; address++) {
+        seed = seed * 1103515245 + 12345;
+        memory.set(address, (seed >> 16) % 176);
+    }
+
+    memory.set(BGP, 0xE4);
+    memory.set(OBP0, 0xD2);
+    memory.set(OBP1, 0x1B);
+
+    // Signed/unsigned tile data, both maps, 8x16 and 8x8 sprites
+    const uint8_t lcdcs[] = { 0xE7, 0xF3, 0xD1, 0x9B };
+    const uint8_t scrolls[][4] = {
+        // SCX, SCY, WX, WY
+        {   0,   0,   7,   0 },
+        {   3, 250,  47,  20 },
+        { 253,  13,   2, 100 },
+        {  77, 130, 166,  10 },
+    };
+
+    for (size_t i=0; i<4; i++) {
+        memory.set(SCX, scrolls[i][0]);
+        memory.set(SCY, scrolls[i][1]);
+        memory.set(WX, scrolls[i][2]);
+        memory.set(WY, scrolls[i][3]);
+
+        for (size_t pass=0; pass<2; pass++) {
+            // Decoded tiles and sprites per line must follow VRAM/OAM writes
+            if (pass == 1) {
+                for (uint16_t address=VRAM_START; address<=TILE_DATA_END; address+=7) {
+                    memory.set(address, memory.get(address) ^ 0x5A);
+                }
+                for (uint16_t address=OAM_START; address<=OAM_END; address+=3) {
+                    memory.set(address, memory.get(address) ^ 0x0F);
+                }
+            }
+
+            // Reference searches OAM on each line
+            graphics.set_sprite_binning(false);
+            render_frame(memory, graphics, RENDERER_FIFO, lcdcs[i]);
+            memcpy(reference, graphics.get_framebuffer(), sizeof(reference));
+
+            graphics.set_sprite_binning(true);
+            render_frame(memory, graphics, RENDERER_SCANLINE, lcdcs[i]);
+            const uint8_t *framebuffer = graphics.get_framebuffer();
+
+            for (size_t y=0; y<SCREEN_HEIGHT; y++) {
+                for (size_t x=0; x<SCREEN_WIDTH; x++) {
+                    size_t index = y * SCREEN_WIDTH + x;
+                    ASSERT_QUIET_SUCCESS(
+                        framebuffer[index] == reference[index],
+                        "LCDC: %02X pass: %zu x: %zu y: %zu", lcdcs[i], pass, x, y);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool test_PPU_framebuffer()
+{
+    MMU memory;
+    PPU graphics;
+    TestVideoSink sink;
+
+    memory.set_ppu(&graphics);
+    graphics.set_mmu(&memory);
+    graphics.init();
+
+    // Tile 0 all color 3 everywhere
+    for (uint16_t address=VRAM_START; address<=VRAM_END; address++) {
+        memory.set(address, address < TILE_ADDRESS_1 + TILE_SIZE ? 0xFF : 0x00);
+    }
+
+    // Drawn without any video sink
+    memory.set(BGP, 0x1B);
+    render_frame(memory, graphics, RENDERER_SCANLINE, 0x91);
+    ASSERT(graphics.get_framebuffer()[0] == 0);
+    ASSERT(graphics.get_framebuffer()[SCREEN_WIDTH * SCREEN_HEIGHT - 1] == 0);
+
+    memory.set(BGP, 0xE4);
+    render_frame(memory, graphics, RENDERER_FIFO, 0x91);
+    ASSERT(graphics.get_framebuffer()[0] == 3);
+
+    render_frame(memory, graphics, RENDERER_SCANLINE, 0x11);
+    ASSERT(graphics.get_framebuffer()[0] == SHADE_LCD_DISABLED);
+
+    // Shades are converted once the frame is complete
+    graphics.set_video_sink(&sink);
+    sink.pixels[0][0] = 0;
+
+    render_frame(memory, graphics, RENDERER_SCANLINE, 0x91);
+    ASSERT(sink.pixels[0][0] == 0);
+
+    graphics.step();
+    ASSERT(graphics.get_current_ly() == LINE_Y_COUNT);
+    ASSERTV(sink.pixels[0][0] == 0x3C504B, "color: %06X", sink.pixels[0][0]);
+    ASSERT(sink.pixels[SCREEN_HEIGHT - 1][SCREEN_WIDTH - 1] == 0x3C504B);
+
+    return true;
+}
+
+
+bool test_PPU_render_interval()
+{
+    MMU memory;
+    PPU graphics;
+    TestVideoSink sink;
+
+    memory.set_ppu(&graphics);
+    graphics.set_mmu(&memory);
+    graphics.init();
+    graphics.set_video_sink(&sink);
+
+    const size_t frame_steps = LINE_Y_COUNT * 3 + V_BLANK_PERIOD;
+    const size_t intervals[] = { 1, 2, RENDER_NEVER };
+    const size_t presented[] = { 4, 2, 0 };
+
+    size_t clock = 0;
+    uint8_t interrupts = 0;
+
+    for (size_t i=0; i<3; i++) {
+        graphics.set_render_interval(intervals[i]);
+        memory.set(IF_ADDRESS, 0x00);
+        memory.set(LCD_STATUS, 0x78);
+        sink.presented = 0;
+
+        render_frame(memory, graphics, RENDERER_SCANLINE, 0x91);
+        for (size_t step=LINE_Y_COUNT * 3; step<frame_steps * 4; step++) {
+            graphics.step();
+        }
+
+        ASSERTV(sink.presented == presented[i], "interval: %zu presented: %zu", intervals[i], sink.presented);
+
+        // Same timings and interrupts whatever is drawn
+        if (i == 0) {
+            clock = graphics.clock;
+            interrupts = memory.get(IF_ADDRESS);
+        }
+        ASSERT(graphics.clock == clock);
+        ASSERT(memory.get(IF_ADDRESS) == interrupts);
+    }
+
+    // Nothing drawn since reset
+    ASSERT(graphics.get_framebuffer()[0] == SHADE_LCD_DISABLED);
+
+    return true;
+}
+
+
+/****************************************************************
+ *
+ *      TEST AUDIO
+ *
+ ****************************************************************/
+
+bool test_AUDIO_sample_ring()
+{
+    SampleRing ring(4);
+    const int16_t frames[] = { 1, -1, 2, -2, 3, -3, 4, -4, 5, -5, 6, -6 };
+
+    ASSERT(ring.size() == 0);
+    ASSERT(ring.push(frames, 3) == 3);
+    ASSERT(ring.size() == 3);
+    ASSERT(ring.get_frame(0)[0] == 1);
+    ASSERT(ring.get_frame(2)[1] == -3);
+
+    // Overrun: what does not fit is dropped
+    ASSERT(ring.push(frames + 6, 3) == 1);
+    ASSERT(ring.size() == 4);
+
+    ring.consume(3);
+    ASSERT(ring.size() == 1);
+    ASSERT(ring.get_frame(0)[0] == 4);
+
+    // Wraps around
+    ASSERT(ring.push(frames + 8, 2) == 2);
+    ASSERT(ring.size() == 3);
+    ASSERT(ring.get_frame(2)[0] == 6);
+    ASSERT(ring.get_frame(2)[1] == -6);
+
+    return true;
+}
+
+bool test_AUDIO_rate_control()
+{
+    int16_t samples[4096];
+    for (size_t i=0; i<2048; i++) {
+        samples[i * 2] = i;
+        samples[i * 2 + 1] = -i;
+    }
+
+    int16_t stream[2048];
+
+    // Above the target: played a bit faster
+    SDLAudio fast;
+    fast.set_latency(20);
+    fast.queue(samples, 4096);
+    fast.fill(stream, 512);
+    ASSERT(stream[0] == 0);
+    ASSERT(stream[1] == 0);
+    ASSERTV(stream[1022] > 511 && stream[1022] < 515, "sample: %d", stream[1022]);
+    ASSERT(stream[1023] == -stream[1022]);
+
+    // Below the target: played a bit slower
+    SDLAudio slow;
+    slow.set_latency(40);
+    slow.queue(samples, 2048);
+    slow.fill(stream, 256);
+    ASSERTV(stream[510] > 252 && stream[510] < 255, "sample: %d", stream[510]);
+
+    // Underrun: last value is held
+    slow.fill(stream, 1024);
+    ASSERTV(stream[2046] > 1020, "sample: %d", stream[2046]);
+    ASSERT(stream[2044] == stream[2046]);
+
+    return true;
+}
+
+bool test_AUDIO_blip_buffer()
+{
+    BlipBuffer buffer;
+    int16_t samples[BLIP_BUFFER_SIZE];
+
+    buffer.set_rates(SOUND_CLOCK_RATE, SOUND_FREQUENCY);
+    ASSERT(buffer.clocks_needed(375) == SOUND_CLOCK_RATE / 128);
+
+    // Steps up at the start, down in the middle
+    buffer.add_delta(0, 10000);
+    buffer.add_delta(SOUND_CLOCK_RATE / 256, -10000);
+    buffer.end_frame(SOUND_CLOCK_RATE / 128);
+    ASSERT(buffer.samples_avail() == 375);
+
+    buffer.read_samples(samples, 375);
+    ASSERT(buffer.samples_avail() == 0);
+
+    // Smoothed over the kernel width
+    ASSERTV(abs(samples[0]) < 100, "sample: %d", samples[0]);
+    ASSERTV(samples[4] > 0 && samples[4] < 9000, "sample: %d", samples[4]);
+    ASSERTV(samples[BLIP_KERNEL_WIDTH] > 9500, "sample: %d", samples[BLIP_KERNEL_WIDTH]);
+
+    // Slowly back to zero, then below it after the second step
+    ASSERT(samples[150] < samples[BLIP_KERNEL_WIDTH]);
+    ASSERTV(samples[180] > 6000, "sample: %d", samples[180]);
+    ASSERTV(samples[187 + BLIP_KERNEL_WIDTH] < -2500, "sample: %d", samples[187 + BLIP_KERNEL_WIDTH]);
+
+    // Nothing left after a while
+    for (size_t i=0; i<20; i++) {
+        buffer.end_frame(SOUND_CLOCK_RATE / 128);
+        buffer.read_samples(samples, buffer.samples_avail());
+    }
+    ASSERTV(abs(samples[374]) < 10, "sample: %d", samples[374]);
+
+    return true;
+}
+
+/**
+ * @brief      Keeps the samples in memory
+ */
+class TestAudioSink : public AudioSink {
+public:
+    std::vector<int16_t> samples;
+
+    void queue(const int16_t *data, size_t count) { samples.insert(samples.end(), data, data + count); };
+};
+
+bool test_AUDIO_batch_synthesis()
+{
+    // Battery cartridge: saved when the DMGs are destroyed
+    {
+        DMG first;
+        DMG second;
+        TestAudioSink first_audio;
+        TestAudioSink second_audio;
+        ASSERT(first.init("", "tests/blargg/sound/03-trigger.gb"));
+        ASSERT(second.init("", "tests/blargg/sound/03-trigger.gb"));
+        first.set_audio_sink(&first_audio);
+        second.set_audio_sink(&second_audio);
+
+        for (size_t frame=0; frame<60; frame++) {
+            first.run_frame();
+        }
+
+        // Whole blocks, sent once their last sample is due
+        size_t frames = first.get_system_clock() * SOUND_FREQUENCY / SOUND_CLOCK_RATE;
+        size_t sent = first_audio.samples.size() / SOUND_CHANNEL_COUNT;
+        ASSERT(first_audio.samples.size() % SOUND_DOWNSAMPLE_BUFFER_SIZE == 0);
+        ASSERTV(sent <= frames && sent + 2 * SOUND_DOWNSAMPLE_SAMPLES > frames,
+            "sent: %zu due: %zu", sent, frames);
+
+        size_t audible = 0;
+        for (int16_t value : first_audio.samples) {
+            audible += value != 0;
+        }
+        ASSERT(audible > 0);
+
+        // Output does not depend on how the emulation is split
+        while (second_audio.samples.size() < first_audio.samples.size()) {
+            second.run_cycles(1000);
+        }
+        ASSERT(std::equal(
+            first_audio.samples.begin(), first_audio.samples.end(), second_audio.samples.begin()));
+    }
+    std::remove("tests/blargg/sound/03-trigger.gb.sav");
+
+    return true;
+}
+
+bool test_AUDIO_null_mode()
+{
+    // Battery cartridge: saved when the DMGs are destroyed
+    {
+        DMG first;
+        DMG second;
+        TestAudioSink first_audio;
+        TestAudioSink second_audio;
+        ASSERT(first.init("", "tests/blargg/sound/03-trigger.gb"));
+        ASSERT(second.init("", "tests/blargg/sound/03-trigger.gb"));
+        first.set_audio_sink(&first_audio);
+        second.set_audio_sink(&second_audio);
+        second.set_audio_synthesis(false);
+
+        // Long enough for the test to report its result
+        for (size_t frame=0; frame<1100; frame++) {
+            first.run_frame();
+            second.run_frame();
+        }
+
+        ASSERT(second_audio.samples.empty());
+        ASSERT(first_audio.samples.size() > 0);
+
+        const uint8_t *first_frame = first.get_framebuffer();
+        const uint8_t *second_frame = second.get_framebuffer();
+        ASSERT(std::equal(first_frame, first_frame + SCREEN_WIDTH * SCREEN_HEIGHT, second_frame));
+
+        // Channels still turn on and off without synthesis
+        ASSERTV(first.get(NR52) == second.get(NR52),
+            "NR52: 0x%02X 0x%02X\n", first.get(NR52), second.get(NR52));
+
+        // Back on
+        second.set_audio_synthesis(true);
+        second.run_frame();
+        ASSERT(second_audio.samples.size() > 0);
+    }
+    std::remove("tests/blargg/sound/03-trigger.gb.sav");
+
+    return true;
+}
+
+/**
+ * @brief      Plays a square wave on Pulse A alone, from a reset APU
+ * @param[in]  nr50  Terminal levels
+ * @param[in]  nr51  Routing of the generators
+ * @return     Four blocks of stereo samples
+ */
+std::vector<int16_t> mix_pulse_a(uint8_t nr50, uint8_t nr51)
+{
+    TestAudioSink audio;
+
+    apu->reset();
+    apu->set_audio_sink(&audio);
+
+    mmu->set(NR52, 0x80);
+    mmu->set(NR50, nr50);
+    mmu->set(NR51, nr51);
+    mmu->set(NR11, 0x80);       // 50% duty
+    mmu->set(NR12, 0xF0);       // Full volume
+    mmu->set(NR13, 0x00);
+    mmu->set(NR14, 0x87);       // Trigger, 512Hz
+
+    apu->synthesize(4 * SOUND_DOWNSAMPLE_SAMPLES * (SOUND_CLOCK_RATE / SOUND_FREQUENCY + 1));
+    apu->set_audio_sink(nullptr);
+
+    audio.samples.resize(4 * SOUND_DOWNSAMPLE_BUFFER_SIZE);
+
+    return audio.samples;
+}
+
+bool test_AUDIO_mixer()
+{
+    // Channels take the clock of a DMG when triggered
+    DMG clock_source;
+    ASSERT(clock_source.init("", "tests/blargg/cpu/01-special.gb"));
+    apu->set_dmg(&clock_source);
+    apu->init();
+
+    // Both terminals at 8/8
+    std::vector<int16_t> full = mix_pulse_a(0x77, 0x11);
+
+    size_t audible = 0;
+    for (size_t n=0; n<full.size(); n+=2) {
+        ASSERT(full[n] == full[n + 1]);
+        audible += full[n] != 0;
+    }
+    ASSERT(audible > 0);
+
+    // SO2 only, at 4/8: left terminal
+    std::vector<int16_t> left = mix_pulse_a(0x37, 0x10);
+    for (size_t n=0; n<left.size(); n+=2) {
+        ASSERTV(left[n] == (full[n] * 4) >> SOUND_LEVEL_BITS, "sample: %zu left: %d full: %d\n", n, left[n], full[n]);
+        ASSERT(left[n + 1] == 0);
+    }
+
+    // SO1 only, at 1/8: right terminal
+    std::vector<int16_t> right = mix_pulse_a(0x70, 0x01);
+    for (size_t n=0; n<right.size(); n+=2) {
+        ASSERT(right[n] == 0);
+        ASSERTV(right[n + 1] == full[n + 1] >> SOUND_LEVEL_BITS, "sample: %zu right: %d full: %d\n",
+            n, right[n + 1], full[n + 1]);
+    }
+
+    // Pulse B routed, Pulse A silent
+    std::vector<int16_t> other = mix_pulse_a(0x77, 0x22);
+    ASSERT(std::all_of(other.begin(), other.end(), [](int16_t value) { return value == 0; }));
+
+    mmu->set(NR52, 0x00);
+    apu->reset();
+    apu->set_dmg(nullptr);
+    apu->init();
+
+    return true;
+}
+
+/****************************************************************
+ *
+ *      TEST DMG
+ *
+ ****************************************************************/
+
+bool test_DMG_run_cycles()
+{
+    DMG dmg;
+    ASSERT(dmg.init("", "tests/blargg/cpu/01-special.gb"));
+
+    dmg.run_cycles(1000);
+    ASSERTV(dmg.get_system_clock() >= 1000, "clock: %zu", dmg.get_system_clock());
+    ASSERTV(dmg.get_system_clock() < 1100, "clock: %zu", dmg.get_system_clock());
+
+    // Overshoot is not accumulated
+    for (size_t i=0; i<100; i++) {
+        dmg.run_cycles(10);
+    }
+    ASSERTV(dmg.get_system_clock() >= 2000, "clock: %zu", dmg.get_system_clock());
+    ASSERTV(dmg.get_system_clock() < 2100, "clock: %zu", dmg.get_system_clock());
+
+    return true;
+}
+
+
+bool test_DMG_run_frame()
+{
+    DMG first;
+    DMG second;
+    ASSERT(first.init("", "tests/blargg/cpu/01-special.gb"));
+    ASSERT(second.init("", "tests/blargg/cpu/01-special.gb"));
+
+    for (size_t frame=1; frame<=60; frame++) {
+        first.run_frame();
+        second.run_frame();
+
+        size_t clock = first.get_system_clock();
+        ASSERTV(clock >= frame * FRAME_CYCLES, "frame: %zu clock: %zu", frame, clock);
+        ASSERTV(clock < frame * FRAME_CYCLES + 100, "frame: %zu clock: %zu", frame, clock);
+        ASSERTV(clock == second.get_system_clock(), "frame: %zu", frame);
+    }
+
+    return true;
+}
+
+
 /****************************************************************
  *
  *      TEST CARTRIDGE OPERATIONS
@@ -1497,6 +2438,310 @@ bool test_CARTRIDGE_read_MBC1()
     return true;
 }
 
+bool test_CARTRIDGE_shared_rom()
+{
+    const char *path = "tests/fake_rom.gb";
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> rom(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Cartridge *first = new Cartridge();
+    Cartridge second;
+    ASSERT(first->load(path));
+    ASSERT(second.load(path));
+
+    // Banks point into the same image
+    const uint8_t *bank = first->mbc->get_rom0_bank();
+    ASSERT(bank == second.mbc->get_rom0_bank());
+    ASSERT(memcmp(bank, rom.data(), MBC_SIZE) == 0);
+
+    // Still there for the other one
+    delete first;
+    ASSERT(memcmp(second.mbc->get_rom1_bank(), rom.data() + MBC_SIZE, MBC_SIZE) == 0);
+
+    return true;
+}
+
+
+bool test_CARTRIDGE_oversized_rom()
+{
+    // Three banks while the header declares two
+    std::vector<uint8_t> rom(3 * MBC_SIZE);
+    rom[CARTRIDGE_TYPE_ADDRESS] = CART_TYPE_MBC1;
+    rom[ROM_SIZE_ADDRESS] = 0x00;
+    for (size_t bank=0; bank<3; bank++) {
+        rom[bank * MBC_SIZE + 0x100] = 0x10 + bank;
+    }
+
+    const char *path = "tests/oversized_rom.gb";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<char*>(rom.data()), rom.size());
+    }
+
+    Cartridge cart;
+    bool loaded = cart.load(path);
+    std::remove(path);
+    ASSERT(loaded);
+
+    // Extra bank ignored, the declared ones are read
+    ASSERT(cart.get(0x0100) == 0x10);
+    ASSERTV(cart.get(0x4100) == 0x11, "value: 0x%02X\n", cart.get(0x4100));
+    ASSERT(cart.mbc->get_rom1_bank() == cart.mbc->get_rom0_bank() + MBC_SIZE);
+
+    return true;
+}
+
+bool test_CARTRIDGE_bank_pointers()
+{
+    Cartridge cart;
+    ASSERT(cart.load("tests/fake_rom.gb"));
+
+    const uint8_t *rom0 = cart.mbc->get_rom0_bank();
+    ASSERT(cart.mbc->get_rom1_bank() == rom0 + MBC_SIZE);
+    ASSERT(cart.mbc->get_ram_bank() == nullptr);
+
+    ASSERT(cart.set(0x2000, 0x02));
+    ASSERT(cart.mbc->get_rom1_bank() == rom0 + 2 * MBC_SIZE);
+    ASSERT(cart.mbc->get_rom0_bank() == rom0);
+
+    // Same bank again: nothing to remap
+    ASSERT(!cart.set(0x2000, 0x02));
+
+    ASSERT(cart.set(0x0000, 0x0A));
+    ASSERT(cart.mbc->get_ram_bank() == cart.mbc->ram);
+
+    return true;
+}
+
+
+bool test_CARTRIDGE_MBC3_clock()
+{
+    std::vector<uint8_t> rom(8 * MBC_SIZE);
+    for (size_t bank=0; bank<8; bank++) {
+        rom[bank * MBC_SIZE] = bank;
+    }
+
+    MBC3 mbc(8, 0x03, true, nullptr);
+    mbc.init();
+    ASSERT(mbc.load(rom.data(), 8));
+
+    // 7 bits bank number
+    mbc.set(0x2000, 0x05);
+    ASSERT(mbc.get(ROM1_START) == 0x05);
+
+    // One day, one hour, one minute and one second
+    mbc.set(0x0000, 0x0A);
+    mbc.update_clock(size_t(RTC_CLOCK_RATE) * (86400 + 3600 + 60 + 1) + 100);
+
+    // Nothing visible until latched
+    mbc.set(0x4000, RTC_SECONDS);
+    ASSERT(mbc.get(SRAM_START) == 0);
+
+    mbc.set(0x6000, 0x00);
+    mbc.set(0x6000, 0x01);
+
+    const uint8_t expected[] = { 1, 1, 1, 1, 0 };
+    for (uint8_t i=0; i<RTC_REGISTER_COUNT; i++) {
+        mbc.set(0x4000, RTC_SECONDS + i);
+        ASSERTV(mbc.get(SRAM_START) == expected[i],
+            "register: 0x%02X value: %u\n", RTC_SECONDS + i, mbc.get(SRAM_START));
+    }
+
+    // Halted, then the last day overflows
+    mbc.set(SRAM_START, RTC_HALT | RTC_DAY_BIT_8);
+    mbc.set(0x4000, RTC_DAY_LOW);
+    mbc.set(SRAM_START, 0xFF);
+    mbc.update_clock(size_t(RTC_CLOCK_RATE) * 100000);
+
+    mbc.set(0x4000, RTC_DAY_HIGH);
+    mbc.set(SRAM_START, RTC_DAY_BIT_8);
+    mbc.update_clock(size_t(RTC_CLOCK_RATE) * (100000 + 86400));
+
+    mbc.set(0x6000, 0x00);
+    mbc.set(0x6000, 0x01);
+    ASSERT(mbc.get(SRAM_START) == RTC_DAY_CARRY);
+
+    mbc.set(0x4000, RTC_DAY_LOW);
+    ASSERT(mbc.get(SRAM_START) == 0x00);
+
+    // RAM banks still there
+    mbc.set(0x4000, 0x02);
+    mbc.set(SRAM_START, 0x42);
+    ASSERT(mbc.get_ram_bank() == mbc.ram + 2 * RAM_MBC_SIZE);
+    ASSERT(mbc.get(SRAM_START) == 0x42);
+
+    return true;
+}
+
+
+/**
+ * @brief      Reads the clock registers visible to the game
+ * @param      mbc     The MBC3, RAM enabled
+ * @param[out] values  RTC_REGISTER_COUNT registers from the seconds
+ * @param[in]  latch   Latches the live registers first
+ */
+void read_MBC3_clock(MBC3 *mbc, uint8_t *values, bool latch)
+{
+    if (latch) {
+        mbc->set(0x6000, 0x00);
+        mbc->set(0x6000, 0x01);
+    }
+
+    for (uint8_t i=0; i<RTC_REGISTER_COUNT; i++) {
+        mbc->set(0x4000, RTC_SECONDS + i);
+        values[i] = mbc->get(SRAM_START);
+    }
+}
+
+bool test_CARTRIDGE_MBC3_clock_save()
+{
+    std::vector<uint8_t> rom(8 * MBC_SIZE);
+    const char *path = "tests/mbc3_clock.sav";
+
+    MBC3 saved(8, 0x03, true, nullptr);
+    MBC3 restored(8, 0x03, true, nullptr);
+    MBC3 masked(8, 0x03, true, nullptr);
+    MBC3 short_block(8, 0x03, true, nullptr);
+    MBC3 no_block(8, 0x03, true, nullptr);
+
+    for (MBC3 *mbc : { &saved, &restored, &masked, &short_block, &no_block }) {
+        mbc->init();
+        mbc->load(rom.data(), 8);
+        mbc->set(0x0000, 0x0A);
+    }
+
+    // Latched at 1 day, 2 hours, 3 minutes and 4 seconds, live 5 seconds later
+    saved.update_clock(size_t(RTC_CLOCK_RATE) * (86400 + 2 * 3600 + 3 * 60 + 4));
+    saved.set(0x6000, 0x00);
+    saved.set(0x6000, 0x01);
+    saved.update_clock(size_t(RTC_CLOCK_RATE) * (86400 + 2 * 3600 + 3 * 60 + 9));
+
+    {
+        std::ofstream file(path, std::ios::binary);
+        saved.save_clock(file);
+    }
+    {
+        std::ifstream file(path, std::ios::binary);
+        restored.load_clock(file);
+    }
+
+    // Every bit set: registers keep the ones they have
+    {
+        std::ofstream file(path, std::ios::binary);
+        uint32_t value = 0xFFFFFFFF;
+        for (size_t i=0; i<2 * RTC_REGISTER_COUNT; i++) {
+            file.write(reinterpret_cast<char*>(&value), sizeof(uint32_t));
+        }
+
+        uint64_t timestamp = 0;
+        file.write(reinterpret_cast<char*>(&timestamp), sizeof(uint64_t));
+    }
+    {
+        std::ifstream file(path, std::ios::binary);
+        masked.load_clock(file);
+    }
+
+    // Clock block cut short
+    {
+        std::ofstream file(path, std::ios::binary);
+        uint32_t value = 0x01;
+        for (size_t i=0; i<3; i++) {
+            file.write(reinterpret_cast<char*>(&value), sizeof(uint32_t));
+        }
+    }
+    {
+        std::ifstream file(path, std::ios::binary);
+        short_block.load_clock(file);
+    }
+
+    // Save without clock block
+    {
+        std::ofstream file(path, std::ios::binary);
+    }
+    {
+        std::ifstream file(path, std::ios::binary);
+        no_block.load_clock(file);
+    }
+
+    std::remove(path);
+
+    uint8_t values[RTC_REGISTER_COUNT];
+
+    const uint8_t latched[] = { 4, 3, 2, 1, 0 };
+    read_MBC3_clock(&restored, values, false);
+    ASSERT(memcmp(values, latched, RTC_REGISTER_COUNT) == 0);
+
+    const uint8_t live[] = { 9, 3, 2, 1, 0 };
+    read_MBC3_clock(&restored, values, true);
+    ASSERT(memcmp(values, live, RTC_REGISTER_COUNT) == 0);
+
+    const uint8_t masks[] = { 0x3F, 0x3F, 0x1F, 0xFF, RTC_DAY_CARRY | RTC_HALT | RTC_DAY_BIT_8 };
+    read_MBC3_clock(&masked, values, false);
+    ASSERT(memcmp(values, masks, RTC_REGISTER_COUNT) == 0);
+    read_MBC3_clock(&masked, values, true);
+    ASSERT(memcmp(values, masks, RTC_REGISTER_COUNT) == 0);
+
+    // Clock left at zero
+    const uint8_t zero[RTC_REGISTER_COUNT] = {};
+    read_MBC3_clock(&short_block, values, true);
+    ASSERT(memcmp(values, zero, RTC_REGISTER_COUNT) == 0);
+    read_MBC3_clock(&no_block, values, true);
+    ASSERT(memcmp(values, zero, RTC_REGISTER_COUNT) == 0);
+
+    return true;
+}
+
+
+bool test_CARTRIDGE_MBC5_banks()
+{
+    std::vector<uint8_t> rom(MBC5_ROM_BANK_COUNT * MBC_SIZE);
+    for (size_t bank=0; bank<MBC5_ROM_BANK_COUNT; bank++) {
+        rom[bank * MBC_SIZE] = bank & 0xFF;
+        rom[bank * MBC_SIZE + 1] = bank >> 8;
+    }
+
+    MBC5 mbc(MBC5_ROM_BANK_COUNT, 0x04);
+    mbc.init();
+    ASSERT(mbc.load(rom.data(), MBC5_ROM_BANK_COUNT));
+    ASSERT(mbc.get_rom1_bank() == rom.data() + MBC_SIZE);
+
+    // 9 bits bank number, written in two registers
+    ASSERT(mbc.set(0x2000, 0x23));
+    ASSERT(mbc.set(0x3000, 0x01));
+    ASSERT(mbc.get_rom1_bank() == rom.data() + 0x123 * MBC_SIZE);
+    ASSERT(mbc.get(ROM1_START) == 0x23 && mbc.get(ROM1_START + 1) == 0x01);
+
+    // Same bank again: nothing to remap
+    ASSERT(!mbc.set(0x2000, 0x23));
+
+    // Bank 0 is not translated to bank 1
+    mbc.set(0x2000, 0x00);
+    mbc.set(0x3000, 0x00);
+    ASSERT(mbc.get_rom1_bank() == rom.data());
+
+    // 16 RAM banks
+    mbc.set(0x0000, 0x0A);
+    mbc.set(0x4000, 0x0F);
+    mbc.set(SRAM_START, 0x42);
+    ASSERT(mbc.get_ram_bank() == mbc.ram + 15 * RAM_MBC_SIZE);
+    ASSERT(mbc.get(SRAM_START) == 0x42);
+
+    mbc.set(0x4000, 0x00);
+    ASSERT(mbc.get(SRAM_START) == 0x00);
+
+    // Truncated dump: banks past the end mirror the ones loaded
+    MBC5 small(MBC5_ROM_BANK_COUNT, 0x00);
+    small.init();
+    ASSERT(small.load(rom.data(), 4));
+    small.set(0x2000, 0x06);
+    ASSERT(small.get(ROM1_START) == 0x02);
+
+    return true;
+}
+
+
 /**
  * @brief      Loads a test cartridge cpu_instrs.gb and does some check
  */
@@ -1599,11 +2844,11 @@ bool test_blargg_cpu_instrs()
         const char *path_rom = cpu_instrs[test_id];
         fprintf(stdout, "BLARGG: %s: ", path_rom);
 
-        DMG dmg;
-        dmg.init("bios/dmg_boot.bin", cpu_instrs[test_id]);
-        dmg.set_palette('1');
-        dmg.set_speed(5000);
-        dmg.run();
+        Frontend frontend;
+        frontend.init("bios/dmg_boot.bin", cpu_instrs[test_id]);
+        frontend.set_palette('1');
+        frontend.set_speed(5000);
+        frontend.run();
 
         fprintf(stdout, "\n");
     }
@@ -1641,6 +2886,9 @@ int main(void)
     fprintf(stdout, "DMG auto testing\n");
 
     test("MMU: RAM check", &test_MMU_ram);
+    test("MMU: ECHO", &test_MMU_echo);
+    test("MMU: I/O masks", &test_MMU_io_masks);
+    test("MMU: Bank switch", &test_MMU_bank_switch);
 
     test("Binary Operations: RLC", &test_BIN_RLC);
     test("Binary Operations: RRC", &test_BIN_RRC);
@@ -1673,13 +2921,43 @@ int main(void)
     test("CPU: POP AF", &test_CPU_POP_AF);
     test("CPU: DAA", &test_CPU_DAA);
     test("CPU: Op SP", &test_CPU_Op_SP);
+    test("CPU: Lazy flags", &test_CPU_lazy_flags);
+    test("CPU: HALT fast forward", &test_CPU_HALT_fast_forward);
+    test("CPU: Polling loop fast forward", &test_CPU_polling_loop_fast_forward);
+    test("CPU: Code cache bank switch", &test_CPU_code_cache_bank_switch);
+    test("CPU: Code cache remap", &test_CPU_code_cache_remap);
 
     test("PROGRAM: Zero memory from $8000 to $9FFF", &test_zero_memory);
     test("PROGRAM: Init sound control registers", &test_audio_init);
     test("PROGRAM: Boot graphic routine", &test_graphic_routine);
 
+    test("SCHEDULER: Events order", &test_SCHEDULER_order);
+
+    test("TIMER: Overflow event", &test_TIMER_overflow_event);
+
+    test("PPU: Tile line decoding", &test_PPU_tile_line_decoding);
+    test("PPU: Scanline renderer", &test_PPU_scanline_renderer);
+    test("PPU: Framebuffer", &test_PPU_framebuffer);
+    test("PPU: Render interval", &test_PPU_render_interval);
+
+    test("AUDIO: Sample ring", &test_AUDIO_sample_ring);
+    test("AUDIO: Rate control", &test_AUDIO_rate_control);
+    test("AUDIO: Blip buffer", &test_AUDIO_blip_buffer);
+    test("AUDIO: Batch synthesis", &test_AUDIO_batch_synthesis);
+    test("AUDIO: Null mode", &test_AUDIO_null_mode);
+    test("AUDIO: Mixer", &test_AUDIO_mixer);
+
+    test("DMG: Run cycles", &test_DMG_run_cycles);
+    test("DMG: Run frame", &test_DMG_run_frame);
+
     test("CARTRIDGE: Post boot", &test_CARTRIDGE_post_boot);
     test("CARTRIDGE: Read from MBC1", &test_CARTRIDGE_read_MBC1);
+    test("CARTRIDGE: Shared ROM", &test_CARTRIDGE_shared_rom);
+    test("CARTRIDGE: Oversized ROM", &test_CARTRIDGE_oversized_rom);
+    test("CARTRIDGE: Bank pointers", &test_CARTRIDGE_bank_pointers);
+    test("CARTRIDGE: MBC3 clock", &test_CARTRIDGE_MBC3_clock);
+    test("CARTRIDGE: MBC3 clock save", &test_CARTRIDGE_MBC3_clock_save);
+    test("CARTRIDGE: MBC5 banks", &test_CARTRIDGE_MBC5_banks);
     test("CARTRIDGE: CPU Instrs", &test_CARTRIDGE_CPU_instrs);
 
     delete cart;
@@ -2,10 +2,20 @@
 
 #include "mmu.h"
 #include "cpu.h"
+#include "dmg.h"
 #include "log.h"
 
 
-Timer::Timer() : mmu(nullptr)
+// Cycles between two TIMA increments, by input clock
+static const size_t frequencies[] = {
+    1024,
+    16,
+    64,
+    256
+};
+
+
+Timer::Timer() : dmg(nullptr), mmu(nullptr)
 {
 
 }
@@ -24,7 +34,7 @@ bool Timer::init()
 
 void Timer::reset()
 {
-    clock = 0;
+    clock = SIZE_MAX;
 
     enabled = false;
     clock_select = 0;
@@ -35,27 +45,75 @@ void Timer::reset()
 
 
 /**
- * @brief      Update the timer
+ * @brief      TIMA overflows: reloads TMA and requests an interrupt
  */
 void Timer::step()
 {
-    const size_t frequencies[] = {
-        1024,
-        16,
-        64,
-        256
-    };
-
-    clock += 16;
-
-    if (clock - last_div_increment > DIV_FREQUENCY) {
-        mmu->set_nocheck(DIV, mmu->get(DIV) + 1);
-        last_div_increment += DIV_FREQUENCY;
+    update(clock);
+
+    last_increment = clock;
+
+    mmu->set_nocheck(TIMA, mmu->get_nocheck(TMA));
+    mmu->trigger_interrupt(INT_TIMER_MASK);
+
+    schedule();
+}
+
+
+/**
+ * @brief      Brings DIV and TIMA up to the current clock before they are accessed
+ */
+void Timer::catch_up()
+{
+    // Not running inside a DMG, there is no clock to follow
+    if (dmg == nullptr) {
+        return;
     }
 
-    if (clock - last_increment > frequencies[clock_select] && enabled) {
-        mmu->set(TIMA, mmu->get(TIMA) + 1);
-        last_increment += frequencies[clock_select];
+    update(dmg->get_current_clock());
+}
+
+
+/**
+ * @brief      Applies the increments due before the given clock
+ *
+ * TIMA never wraps here as its overflow is an event of its own.
+ * @param[in]  target  The clock
+ */
+void Timer::update(size_t target)
+{
+    if (target > last_div_increment + DIV_FREQUENCY) {
+        size_t count = (target - last_div_increment - 1) / DIV_FREQUENCY;
+
+        mmu->set_nocheck(DIV, mmu->get_nocheck(DIV) + count);
+        last_div_increment += count * DIV_FREQUENCY;
+    }
+
+    size_t frequency = frequencies[clock_select];
+
+    if (enabled && target > last_increment + frequency) {
+        size_t count = (target - last_increment - 1) / frequency;
+
+        mmu->set_nocheck(TIMA, mmu->get_nocheck(TIMA) + count);
+        last_increment += count * frequency;
+    }
+}
+
+
+/**
+ * @brief      Posts the next TIMA overflow
+ */
+void Timer::schedule()
+{
+    clock = SIZE_MAX;
+
+    if (enabled) {
+        size_t increments = 0x100 - mmu->get_nocheck(TIMA);
+        clock = last_increment + increments * frequencies[clock_select];
+    }
+
+    if (dmg != nullptr) {
+        dmg->schedule(EVENT_TIMER, clock);
     }
 }
 
@@ -84,11 +142,14 @@ void Timer::set_TAC(uint8_t value)
     if ((new_enabled && !enabled) ||
     // Change cycle
         (new_clock_select != clock_select)) {
-        last_increment = clock;
+        size_t now = (dmg != nullptr) ? dmg->get_current_clock() : 0;
+        last_increment = (now + TIMER_RESOLUTION - 1) / TIMER_RESOLUTION * TIMER_RESOLUTION;
     }
 
     enabled = new_enabled;
     clock_select = new_clock_select;
+
+    schedule();
 }
 
 
@@ -96,23 +157,38 @@ void Timer::set_TIMA(uint8_t value)
 {
     // Overflow
     if (value == 0x00) {
-        mmu->set_nocheck(TIMA, mmu->get(TMA));
+        mmu->set_nocheck(TIMA, mmu->get_nocheck(TMA));
 
         // Interrupt
         mmu->trigger_interrupt(INT_TIMER_MASK);
     }
+
+    schedule();
 }
 
 
 void Timer::adjust_clocks(size_t adjustment)
 {
-    clock -= adjustment;
+    // Counters left unread for long would fall behind the adjustment
+    if (dmg != nullptr) {
+        update(dmg->get_system_clock());
+    }
+
+    if (clock != SIZE_MAX) {
+        clock -= adjustment;
+    }
 
     last_increment -= adjustment;
     last_div_increment -= adjustment;
 }
 
 
+void Timer::set_dmg(DMG *dmg)
+{
+    this->dmg = dmg;
+}
+
+
 void Timer::set_mmu(MMU *mmu)
 {
     this->mmu = mmu;
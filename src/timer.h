@@ -10,13 +10,19 @@
 
 
 class MMU;
+class DMG;
 
 
 /**
  * @brief      Handle the DMG main timer
+ *
+ * Nothing runs while counting: DIV and TIMA are brought up to date from the
+ * clock of their last increment only when read or written. The only event
+ * is the next TIMA overflow, which requests an interrupt.
  */
 class Timer {
 private:
+    DMG *dmg;
     MMU *mmu;
 
     bool enabled;
@@ -25,14 +31,18 @@ private:
     size_t last_increment;
     size_t last_div_increment;
 
+    void update(size_t target);
+    void schedule();
+
 public:
-    size_t clock;
+    size_t clock;           // Next TIMA overflow, SIZE_MAX if none
 
     Timer();
 
     bool init();
     void reset();
     void step();
+    void catch_up();
 
     void set_DIV(uint8_t value);
     void set_TAC(uint8_t value);
@@ -40,6 +50,7 @@ public:
 
     void adjust_clocks(size_t adjustment);
 
+    void set_dmg(DMG *dmg);
     void set_mmu(MMU *mmu);
 
     void serialize(std::ofstream &file);
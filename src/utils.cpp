@@ -1,10 +1,30 @@
 #include <stdio.h>
+#include <string.h>
 #include <sstream>
 #include <iostream>
 
 #include "utils.h"
 
 
+/**
+ * @brief      Bits of each byte spread over 8 bytes, b7 first
+ */
+struct BitSpread {
+    uint8_t bits[256][8];
+
+    constexpr BitSpread() : bits()
+    {
+        for (size_t value=0; value<256; value++) {
+            for (size_t i=0; i<8; i++) {
+                bits[value][i] = (value >> (7 - i)) & 0x01;
+            }
+        }
+    }
+};
+
+static constexpr BitSpread bit_spread;
+
+
 bool get_bit(uint8_t byte, size_t offset)
 {
     return  byte & (1 << offset);
@@ -106,30 +126,22 @@ uint8_t get_pixel_value(uint8_t data1, uint8_t data2, size_t index)
 }
 
 
-void set_pixel(SDL_Surface *surface, size_t x, size_t y, Uint32 color)
-{
-    Uint32 *pixels = (Uint32 *) surface->pixels;
-
-    pixels[(y * surface->w) + x] = color;
-}
-
-
 /**
- * @brief      Given an array of data, give a texture ID
- * @param      data data to use for pixels array of [3] for RGB
- * @return     ImGui texture ID
+ * @brief      Get the 8 pixels of a tile line at once
+ * Both bit planes are spread with a table then merged as 64 bits words,
+ * a pixel never overflows its byte
+ * @param[in]  data1   First data row of that tile line
+ * @param[in]  data2   Second data row of that tile line
+ * @param      pixels  The 8 pixel values, leftmost first
  */
-GLuint create_texture(uint8_t data[], size_t width, size_t height)
+void decode_tile_line(uint8_t data1, uint8_t data2, uint8_t pixels[])
 {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
+    uint64_t low;
+    uint64_t high;
+    memcpy(&low, bit_spread.bits[data1], sizeof(uint64_t));
+    memcpy(&high, bit_spread.bits[data2], sizeof(uint64_t));
 
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    return textureID;
+    uint64_t line = low | (high << 1);
+    memcpy(pixels, &line, sizeof(uint64_t));
 }
+
@@ -4,10 +4,6 @@
 #include <inttypes.h>
 #include <stdbool.h>
 #include <cstddef>
-#include <SDL2/SDL.h>
-#include <GL/gl3w.h>
-
-#include "imgui.h"
 
 #define UTIL_LEFT       true
 #define UTIL_RIGHT      false
@@ -22,7 +18,6 @@ void inc16(uint8_t *address);
 uint16_t char_to_hex(const char *value);
 
 uint8_t get_pixel_value(uint8_t data1, uint8_t data2, size_t index);
-void set_pixel(SDL_Surface *surface, size_t x, size_t y, Uint32 color);
-GLuint create_texture(uint8_t data[], size_t width, size_t height);
+void decode_tile_line(uint8_t data1, uint8_t data2, uint8_t pixels[]);
 
 #endif /* UTILS_H */
@@ -0,0 +1,33 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <stdint.h>
+
+
+/**
+ * @brief      Abstract class to anything following the execution
+ *
+ * A watcher is told about memory accesses when breakpoints are activated and
+ * can suspend the emulation. The emulator runs the same without one.
+ */
+class Watcher {
+public:
+    bool suspend_dmg;
+    bool step_dmg;
+
+    bool breakpoint_activated;
+
+    Watcher() : suspend_dmg(false), step_dmg(false), breakpoint_activated(false) {};
+    virtual ~Watcher() = default;
+
+    virtual void feed_memory_write(uint16_t address) = 0;
+    virtual void feed_memory_read(uint16_t address) = 0;
+
+    /**
+     * @brief      Indicates if the DMG should stop processing
+     * @return     true if execution is suspended and no step is requested
+     */
+    bool is_suspended() { return suspend_dmg && !step_dmg; };
+};
+
+#endif /* WATCHER_H */